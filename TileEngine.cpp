@@ -1,6 +1,7 @@
 #include "TileEngine.h"
 
 #include "common.h"
+#include "recorder.h"
 
 #include <algorithm>
 #include <stdio.h>
@@ -12,198 +13,376 @@ TileEngine::LastUsedFontSettings TileEngine::_lastUsedFontSettings;
 unsigned int TileEngine::_layerIds = 0;
 
 
-PsychedlicFilter::PsychedlicFilter() : changeTick(FPS)
+void FilterBuffer::resize(int w, int h)
 {
+    if ((w == width) && (h == height)) return;
+
+    sys::mem_untrack(sys::MEM_RENDER, size() * (2 + 2 * CHANNELS));
+
+    width = w;
+    height = h;
+
+    glyph.resize(size());
+    font.resize(size());
+    for (int c = 0; c < CHANNELS; c++) {
+        fg[c].resize(size());
+        bg[c].resize(size());
+    }
+
+    sys::mem_track(sys::MEM_RENDER, size() * (2 + 2 * CHANNELS));
 }
 
-PsychedlicFilter::~PsychedlicFilter()
+void FilterBuffer::set(int i, const Icon &icon)
 {
+    glyph[i] = icon._val;
+    font[i] = icon._font;
+    fg[R][i] = icon._fg.r; fg[G][i] = icon._fg.g; fg[B][i] = icon._fg.b; fg[A][i] = icon._fg.a;
+    bg[R][i] = icon._bg.r; bg[G][i] = icon._bg.g; bg[B][i] = icon._bg.b; bg[A][i] = icon._bg.a;
 }
 
-Icon PsychedlicFilter::operator()(const Icon &i, int x, int y)
+Icon FilterBuffer::get(int i) const
 {
-    static const gtti::Gradient g(gtti::Color(232, 12, 223), gtti::Color(191, 0, 255), gtti::Color(117, 12, 232));
-    static const float alphaRange = 0.25f;
-    static const float alphaMin = 0.05f;
+    Icon icon;
 
-    Icon ret = i;
+    icon._val = glyph[i];
+    icon._font = font[i];
+    icon._fg = Color{ fg[R][i], fg[G][i], fg[B][i], fg[A][i] };
+    icon._bg = Color{ bg[R][i], bg[G][i], bg[B][i], bg[A][i] };
 
-    float alpha = alphaMin + alphaRange * fabs(sin(alphaFreq * tick + alphaPhase));
-    float blend = fabs(sin(blendFreq * tick + blendPhase));
+    return icon;
+}
 
-    if (x == 0 && y == 0) {
-        tick += (1.0f / (float)FPS);
+///////////////////////////////////////////////////////////////////////////////
 
-        if (changeTick.tick()) {
-            changeTick.restart(Rnd::betweenf(1.0, 3.0) * FPS);
-            alphaFreq = Rnd::betweenf(0.5, 3.5);
-        }
+void Filter::tint(unsigned char *plane, int n, unsigned char v, int w)
+{
+    const int c = v * w;
+    const int iw = 256 - w;
+
+    for (int i = 0; i < n; i++) {
+        plane[i] = (unsigned char)((plane[i] * iw + c) >> 8);
     }
+}
+
+void Filter::tint(FilterBuffer &buf, const gtti::Color &c, float percent)
+{
+    const int n = buf.size();
+    const int w = (int)(std::max(0.0f, std::min(1.0f, percent)) * 256.0f);
+    const unsigned char rgb[3] = { (unsigned char)c.r(), (unsigned char)c.g(), (unsigned char)c.b() };
 
-    ret._bg = gtti::Color::blend(gtti::Color(ret._bg), g.getColor(blend), alpha).toColor();
-    ret._fg = gtti::Color::blend(gtti::Color(ret._fg), g.getColor(blend), alpha).toColor();
+    for (int ch = FilterBuffer::R; ch <= FilterBuffer::B; ch++) {
+        tint(buf.fg[ch].data(), n, rgb[ch], w);
+        tint(buf.bg[ch].data(), n, rgb[ch], w);
+    }
 
-    return ret;
+    // gtti::Color::blend always produced opaque colors
+    std::fill(buf.fg[FilterBuffer::A].begin(), buf.fg[FilterBuffer::A].end(), 255);
+    std::fill(buf.bg[FilterBuffer::A].begin(), buf.bg[FilterBuffer::A].end(), 255);
 }
 
-FadeFilter::FadeFilter(float out, float hold, float in, const gtti::Color &c) :
-    _in(in * FPS), _out(out * FPS), _hold(hold * FPS), _c(c)
-{
+///////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+// x / 255, rounded, exact for x in [0, 255 * 255]
+inline unsigned char div255(int x)
+{
+    x += 128;
+    return (unsigned char)((x + (x >> 8)) >> 8);
 }
 
-FadeFilter::~FadeFilter()
+// s over d for straight (not premultiplied) colors
+Color over(Color d, Color s)
 {
+    if (s.a == 255) return s;
+    if (s.a == 0) return d;
+
+    int da = div255(d.a * (255 - s.a));
+    int oa = s.a + da;
+
+    if (oa == 0) return BLANK;
+
+    Color o;
+    o.r = (unsigned char)((s.r * s.a + d.r * da + oa / 2) / oa);
+    o.g = (unsigned char)((s.g * s.a + d.g * da + oa / 2) / oa);
+    o.b = (unsigned char)((s.b * s.a + d.b * da + oa / 2) / oa);
+    o.a = (unsigned char)oa;
 
+    return o;
 }
 
-Icon FadeFilter::operator()(const Icon &i, int x, int y)
+// straight s over premultiplied d, n cells.  There are no branches so the
+// compiler is free to vectorize the loop
+void overPlanes(unsigned char **d, const unsigned char *const *s, const unsigned char *sa, int n)
 {
-    if (x == 0 && y == 0) {
-        switch (_state) {
-            case FF_OUT:
-            {
-                _alpha = _out.percent();
-                if (_out.tick()) {
-                    _state = FF_HOLD;
-                }
-                break;
-            }
-            case FF_IN:
-            {
-                _alpha = 1.0f - _in.percent();
-                if (_in.tick()) {
-                    _state = FF_IDLE;
-                }
-                break;
-            }
-            case FF_HOLD:
-            {
-                _alpha = 1.0f;
-                if (_hold.tick()) {
-                    _state = FF_IN;
-                }
-                break;
-            }
-            default:
-                _alpha = 0.0f;
-                break;
+    for (int i = 0; i < n; i++) {
+        int a = sa[i];
+        int ia = 255 - a;
+
+        d[0][i] = div255(s[0][i] * a + d[0][i] * ia);
+        d[1][i] = div255(s[1][i] * a + d[1][i] * ia);
+        d[2][i] = div255(s[2][i] * a + d[2][i] * ia);
+        d[3][i] = div255(a * 255 + d[3][i] * ia);
+    }
+}
+
+// premultiplied back to straight
+void unpremultiply(unsigned char **p, int n)
+{
+    for (int i = 0; i < n; i++) {
+        int a = p[3][i];
+
+        if (a == 0) {
+            p[0][i] = p[1][i] = p[2][i] = 0;
+        } else if (a != 255) {
+            p[0][i] = (unsigned char)std::min(255, (p[0][i] * 255 + a / 2) / a);
+            p[1][i] = (unsigned char)std::min(255, (p[1][i] * 255 + a / 2) / a);
+            p[2][i] = (unsigned char)std::min(255, (p[2][i] * 255 + a / 2) / a);
         }
     }
+}
 
-    Icon ret = i;
+} // namespace
 
-    ret._bg = gtti::Color::blend(gtti::Color(ret._bg), _c, _alpha).toColor();
-    ret._fg = gtti::Color::blend(gtti::Color(ret._fg), _c, _alpha).toColor();
+void Compositor::begin(int w, int h)
+{
+    _buf.resize(w, h);
 
-    return ret;
+    std::fill(_buf.glyph.begin(), _buf.glyph.end(), 0);
+    std::fill(_buf.font.begin(), _buf.font.end(), 0);
+
+    for (int c = 0; c < FilterBuffer::CHANNELS; c++) {
+        std::fill(_buf.fg[c].begin(), _buf.fg[c].end(), 0);
+        std::fill(_buf.bg[c].begin(), _buf.bg[c].end(), 0);
+    }
 }
 
-ThunderstormFilter::ThunderstormFilter() :
-    _lightening(0.1f, 0.0f, 0.5f, gtti::Color::white),
-    _rain(FPS * Rnd::betweenf(3.5f, 6.0f)),
-    _rate(6)
+void Compositor::over(const FilterBuffer &layer, int x, int y)
 {
+    // clip the layer to the buffer
+    int x0 = std::max(0, x);
+    int y0 = std::max(0, y);
+    int x1 = std::min(_buf.width, x + layer.width);
+    int y1 = std::min(_buf.height, y + layer.height);
+
+    if ((x1 <= x0) || (y1 <= y0)) return;
+
+    const int n = x1 - x0;
+
+    for (int row = y0; row < y1; row++) {
+        int di = x0 + row * _buf.width;
+        int si = (x0 - x) + (row - y) * layer.width;
+
+        unsigned char *dbg[4], *dfg[4];
+        const unsigned char *sbg[4];
+
+        for (int c = 0; c < FilterBuffer::CHANNELS; c++) {
+            dbg[c] = &_buf.bg[c][di];
+            dfg[c] = &_buf.fg[c][di];
+            sbg[c] = &layer.bg[c][si];
+        }
+
+        // the background covers the cells below, glyphs included
+        overPlanes(dbg, sbg, sbg[FilterBuffer::A], n);
+        overPlanes(dfg, sbg, sbg[FilterBuffer::A], n);
+
+        // and a glyph of the layer replaces the one below
+        for (int i = 0; i < n; i++) {
+            unsigned char g = layer.glyph[si + i];
+
+            if ((g == 0) || (g == ' ')) continue;
+
+            int a = layer.fg[FilterBuffer::A][si + i];
+            int ia = 255 - a;
+
+            _buf.glyph[di + i] = g;
+            _buf.font[di + i] = layer.font[si + i];
 
+            for (int c = FilterBuffer::R; c <= FilterBuffer::B; c++) {
+                _buf.fg[c][di + i] = div255(layer.fg[c][si + i] * a + _buf.bg[c][di + i] * ia);
+            }
+
+            _buf.fg[FilterBuffer::A][di + i] = div255(a * 255 + _buf.bg[FilterBuffer::A][di + i] * ia);
+        }
+    }
 }
 
-ThunderstormFilter::~ThunderstormFilter()
+const FilterBuffer& Compositor::end()
 {
+    unsigned char *fg[4], *bg[4];
 
+    for (int c = 0; c < FilterBuffer::CHANNELS; c++) {
+        fg[c] = _buf.fg[c].data();
+        bg[c] = _buf.bg[c].data();
+    }
+
+    unpremultiply(fg, _buf.size());
+    unpremultiply(bg, _buf.size());
+
+    return _buf;
 }
 
-Icon ThunderstormFilter::operator()(const Icon &i, int x, int y)
+///////////////////////////////////////////////////////////////////////////////
+
+FilterChain::~FilterChain()
 {
-    static const unsigned int offset = 43;
+    for (Filter *f : _filters) {
+        delete f;
+    }
+}
 
-    _count++;
+void FilterChain::add(Filter *f)
+{
+    if (f) _filters.push_back(f);
+}
 
-    if (x == 0 && y == 0) {
-        if (_isRaining) {
-            if (_rain.tick()) {
-                _isRaining = !Rnd::one_in(3);
-                _rain.restart(FPS * Rnd::betweenf(2.0f, 5.0f));
-                _rate.reset();
-            } else {
-                if (_rate.tick()) {
-//                    _offset++;
-                }
-            }
+void FilterChain::begin()
+{
+    std::vector<Filter*>::iterator it = _filters.begin();
+
+    while (it != _filters.end()) {
+        if ((*it)->done()) {
+            delete *it;
+            it = _filters.erase(it);
         } else {
-            if (_lightening.done()) {
-                _isRaining = true;
-                _lightening.reset();
-            }
+            (*it)->begin();
+            it++;
         }
     }
+}
 
-    if (y == 0) {
-        _count = x + _tick++;
+void FilterChain::apply(FilterBuffer &buf)
+{
+    for (Filter *f : _filters) {
+        f->apply(buf);
     }
+}
 
-    if (_isRaining) {
-        Icon ret = i;
+bool FilterChain::changing() const
+{
+    for (const Filter *f : _filters) {
+        if (f->changing()) return true;
+    }
 
-        if ((_count % offset) == 0 && Rnd::one_in(3)) {
-            ret._val = '\'';// 176;
-            ret._fg = gtti::Color(131, 165, 255).toColor();
-        }
+    return false;
+}
 
-        ret._fg = gtti::Color::blend(gtti::Color(ret._fg), gtti::Color(77, 80, 87), 0.2f).toColor();
-        ret._bg = gtti::Color::blend(gtti::Color(ret._bg), gtti::Color(77, 80, 87), 0.2f).toColor();
+///////////////////////////////////////////////////////////////////////////////
 
-        return ret;
-    } else {
-        return _lightening(i, x, y);
+PsychedlicFilter::PsychedlicFilter() : changeTick(FPS)
+{
+}
+
+PsychedlicFilter::~PsychedlicFilter()
+{
+}
+
+void PsychedlicFilter::begin()
+{
+    static const gtti::Gradient g = gtti::Gradient(gtti::Color(232, 12, 223), gtti::Color(191, 0, 255), gtti::Color(117, 12, 232)).bake();
+    static const float alphaRange = 0.25f;
+    static const float alphaMin = 0.05f;
+
+    // neither value depends on the cell, so they are worked out once a frame
+    _alpha = alphaMin + alphaRange * fabs(sin(alphaFreq * tick + alphaPhase));
+    _c = g.getColor(fabs(sin(blendFreq * tick + blendPhase)));
+
+    tick += (1.0f / (float)FPS);
+
+    // the change is kept on the animation scheduler if there is one
+    if (!_change.running() &&
+        !_change.start(changeTick.ticksLeft(), [this] { return change(); })) {
+
+        if (changeTick.tick()) {
+            change();
+        }
     }
 }
 
+int PsychedlicFilter::change()
+{
+    changeTick.restart(Rnd::betweenf(1.0, 3.0) * FPS);
+    alphaFreq = Rnd::betweenf(0.5, 3.5);
 
+    return changeTick.timeout();
+}
 
-void Console::Tile::setDimensions(int w, int h)
+void PsychedlicFilter::apply(FilterBuffer &buf)
 {
-    _size = Size(w, h);
+    tint(buf, _c, _alpha);
 }
 
-void Console::Tile::draw(Filter *filter, Texture2D tex, int x, int y) const
+FadeFilter::FadeFilter(float out, float hold, float in, const gtti::Color &c) :
+    _in(in * FPS), _out(out * FPS), _hold(hold * FPS), _c(c)
 {
-    Vector2 pos;
-    Rectangle frm;
 
-    Icon icon = _icon;
-    if (filter) {
-        icon = (*filter)(_icon, x, y);
-    }
+}
 
-    frm.x = _size.width() * (icon._val % 16);
-    frm.y = _size.height() * (icon._val / 16);
-    frm.width = _size.width();
-    frm.height = _size.height();
+FadeFilter::~FadeFilter()
+{
 
-    pos.x = x;
-    pos.y = y;
+}
 
-    if (icon._bg.a != 0) {
-        DrawRectangle(pos.x, pos.y, _size.width(), _size.height(), icon._bg);
-    }
+void FadeFilter::begin()
+{
+    switch (_state) {
+        case FF_OUT:
+        {
+            _alpha = _out.percent();
+            if (_out.tick()) {
+                _state = FF_HOLD;
+            }
+            break;
+        }
+        case FF_IN:
+        {
+            _alpha = 1.0f - _in.percent();
+            if (_in.tick()) {
+                _state = FF_IDLE;
+            }
+            break;
+        }
+        case FF_HOLD:
+        {
+            _alpha = 1.0f;
 
-    if (icon._val == 0 || icon._val == ' ') return;
+            // a hold is only waited out, the scheduler wakes us when it is
+            // over rather than every frame drawing the same thing
+            if (_holding.running()) break;
 
-    DrawTextureRec(tex, frm, pos, icon._fg);
-}
+            if ((_hold.timeout() > 1) &&
+                _holding.start(_hold.ticksLeft(), [this] { _hold.reset(); _state = FF_IN; return 0; })) {
+                break;
+            }
 
+            if (_hold.tick()) {
+                _state = FF_IN;
+            }
+            break;
+        }
+        default:
+            _alpha = 0.0f;
+            break;
+    }
+}
 
-Console::Console(const char *font, int cw, int ch, int sw, int sh) : _pos(0, 0), _size(sw, sh), _csize(cw, ch)
+void FadeFilter::apply(FilterBuffer &buf)
 {
-    _table = new Console::Tile[sw * sh];
+    tint(buf, _c, _alpha);
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
-    Image img = LoadImage(font);
-    ImageAlphaMask(&img, img);
+void Console::Tile::setDimensions(int w, int h)
+{
+    _size = Size(w, h);
+}
 
-    //Texture2D ascii = LoadTexture("ascii.png");
-    _texture.load(img);
 
-    UnloadImage(img);
+Console::Console(const char *font, int cw, int ch, int sw, int sh) : _font(font, cw, ch), _pos(0, 0), _size(sw, sh), _csize(cw, ch)
+{
+    _table = new Console::Tile[sw * sh];
+    sys::mem_track(sys::MEM_RENDER, sizeof(Console::Tile) * sw * sh);
 
     for (int i = 0; i < (sw * sh); i++) {
         _table[i].setDimensions(cw, ch);
@@ -214,11 +393,13 @@ Console::Console(const char *font, int cw, int ch, int sw, int sh) : _pos(0, 0),
 Console::Console(int w, int h) : _pos(0, 0), _size(w, h)
 {
     _table = new Console::Tile[w * h];
+    sys::mem_track(sys::MEM_RENDER, sizeof(Console::Tile) * w * h);
 }
 
-Console::Console(const Console &c, int w, int h) : _texture(c._texture), _font(c._font), _pos(c._pos), _size(w, h), _csize(c._csize)
+Console::Console(const Console &c, int w, int h) : _font(c._font), _pos(c._pos), _size(w, h), _csize(c._csize)
 {
     _table = new Console::Tile[w * h];
+    sys::mem_track(sys::MEM_RENDER, sizeof(Console::Tile) * w * h);
 
     for (int i = 0; i < (w * h); i++) {
         _table[i].setDimensions(_csize.width(), _csize.height());
@@ -228,7 +409,15 @@ Console::Console(const Console &c, int w, int h) : _texture(c._texture), _font(c
 
 Console::~Console()
 {
+    sys::mem_untrack(sys::MEM_RENDER, sizeof(Console::Tile) * _size.area());
+
     delete[] _table;
+    delete _filter;
+
+    if (_cacheValid) {
+        sys::mem_untrack(sys::MEM_RENDER, _size.area() * _csize.area() * 4);
+        gtti::backend::current()->unload(_cache);
+    }
 }
 
 void Console::getCharSize(int *w, int *h)
@@ -242,112 +431,350 @@ void Console::getCharSize(int *w, int *h)
     }
 }
 
+const FilterBuffer& Console::frame()
+{
+    _filtered.resize(_size.width(), _size.height());
+
+    for (int i = 0; i < _size.area(); i++) {
+        _filtered.set(i, _table[i].icon());
+    }
+
+    for (int i = 0; i < _size.area(); i++) {
+        if (!_filtered.font[i]) _filtered.font[i] = _font.id();
+    }
+
+    // filters see the whole console at once
+    if (_filter) {
+        _filter->begin();
+        _filter->apply(_filtered);
+
+        // every filter has finished
+        if (_filter->done()) {
+            delete _filter;
+            _filter = nullptr;
+            touchAll();
+        }
+    }
+
+    return _filtered;
+}
+
+void Console::build(const Rect &r, float ox, float oy)
+{
+    const int w = _size.width();
+    const int cw = _csize.width();
+    const int ch = _csize.height();
+
+    gtti::atlas *atlas = gtti::atlas::instance();
+
+    _frame.resize(_size.area());
+    _bgQuads.clear();
+    _glyphQuads.clear();
+
+    if (_filter) {
+        const FilterBuffer &f = frame();
+
+        for (int i = 0; i < _size.area(); i++) {
+            _frame[i] = f.get(i);
+        }
+    } else {
+        for (int y = r.top(); y < r.bottom(); y++) {
+            for (int x = r.left(); x < r.right(); x++) {
+                _frame[x + y * w] = at(x, y).icon();
+            }
+        }
+    }
+
+    for (int y = r.top(); y < r.bottom(); y++) {
+        float py = oy + (float)(y * ch);
+        Quad *run = nullptr;
+
+        for (int x = r.left(); x < r.right(); x++) {
+            const Icon &icon = _frame[x + y * w];
+            float px = ox + (float)(x * cw);
+
+            // neighbouring backgrounds of the same color share one quad
+            if (icon._bg.a == 0) {
+                run = nullptr;
+            } else if (run && same(run->color, icon._bg)) {
+                run->dst.width += cw;
+            } else {
+                Quad q = { { px, py, (float)cw, (float)ch }, { 0, 0, 0, 0 }, icon._bg, 0 };
+                _bgQuads.push_back(q);
+                run = &_bgQuads.back();
+            }
+
+            if (icon._val == 0 || icon._val == ' ') continue;
+
+            gtti::atlas::id f = (icon._font ? icon._font : _font.id());
+            if (!atlas->valid(f)) continue;
+
+            Rectangle src = atlas->glyph(f, icon._val);
+
+            // glyphs of another size sit in the middle of the cell
+            Quad g = {
+                { px + (float)((cw - (int)src.width) / 2), py + (float)((ch - (int)src.height) / 2), src.width, src.height },
+                src,
+                icon._fg,
+                atlas->texture(f)
+            };
+            _glyphQuads.push_back(g);
+        }
+    }
+}
+
+void Console::submit() const
+{
+    // every background first, then every glyph - neither pass switches
+    // texture, so raylib submits each as one batched draw instead of
+    // flushing on every cell
+    gtti::backend *b = gtti::backend::current();
+
+    for (const Quad &q : _bgQuads) {
+        b->fill(q.dst, q.color);
+    }
+
+    for (const Quad &q : _glyphQuads) {
+        b->blit(q.texture, q.src, Vector2{ q.dst.x, q.dst.y }, q.color);
+    }
+}
+
+void Console::setCached(bool cached)
+{
+    _cached = cached;
+    touchAll();
+}
+
+void Console::updateCache()
+{
+    const int w = _size.width();
+    const int h = _size.height();
+    bool full = false;
+
+    if (!_cacheValid) {
+        _cache = gtti::backend::current()->createTarget(w * _csize.width(), h * _csize.height());
+        _cacheValid = true;
+        _drawn.assign(w * h, Icon());
+        sys::mem_track(sys::MEM_RENDER, _size.area() * _csize.area() * 4);
+
+        touchAll();
+        full = true;
+    }
+
+    if (_touchRight <= _touchLeft) return;
+
+    // of the touched cells, find the ones that really differ from the cache
+    int left = w, top = h, right = -1, bottom = -1;
+
+    for (int y = _touchTop; y < _touchBottom; y++) {
+        for (int x = _touchLeft; x < _touchRight; x++) {
+            const Icon &i = at(x, y).icon();
+            Icon &d = _drawn[x + y * w];
+
+            if (full || (i._val != d._val) || (i._font != d._font) || !same(i._fg, d._fg) || !same(i._bg, d._bg)) {
+                left = std::min(left, x);
+                top = std::min(top, y);
+                right = std::max(right, x + 1);
+                bottom = std::max(bottom, y + 1);
+                d = i;
+            }
+        }
+    }
+
+    _touchLeft = _touchTop = _touchRight = _touchBottom = 0;
+
+    if (right < 0) return;
+
+    Rect dirty(top, left, bottom, right);
+
+    // opaque cells simply paint over what was there, anything else needs the
+    // whole cache cleared and redrawn
+    for (int y = dirty.top(); (y < dirty.bottom()) && !full; y++) {
+        for (int x = dirty.left(); x < dirty.right(); x++) {
+            if (at(x, y).icon()._bg.a != 255) {
+                full = true;
+                break;
+            }
+        }
+    }
+
+    if (full) {
+        dirty = Rect(0, 0, h, w);
+
+        for (int i = 0; i < (w * h); i++) {
+            _drawn[i] = _table[i].icon();
+        }
+    }
+
+    build(dirty, 0.0f, 0.0f);
+
+    gtti::backend *b = gtti::backend::current();
+
+    b->beginTarget(_cache);
+        if (full) b->clear(BLANK);
+        submit();
+    b->endTarget();
+}
+
 void Console::draw()
 {
-    if (!_texture) return;
+    if (!_font) return;
     if (!_visible) return;
 
-    for (int x = 0; x < _size.width(); x++) {
-        for (int y = 0; y < _size.height(); y++) {
-            int px = (x + _pos.x()) * _csize.width();
-            int py = (y + _pos.y()) * _csize.height();
-            at(x, y).draw(_filter, _texture, px, py);
-        }
+    float ox = (float)(_pos.x() * _csize.width());
+    float oy = (float)(_pos.y() * _csize.height());
+
+    // filtered consoles change every frame, there is nothing to cache
+    if (!_cached || _filter) {
+        build(Rect(0, 0, _size.height(), _size.width()), ox, oy);
+        submit();
+
+        touchAll();
+        return;
     }
+
+    updateCache();
+
+    gtti::backend::current()->blitTarget(_cache, Vector2{ ox, oy });
 }
 
 void Console::clear()
 {
+    static const Icon blank;
+
     for (int x = 0; x < _size.width(); x++) {
         for (int y = 0; y < _size.height(); y++) {
-            at(x, y) = Tile();
-            at(x, y).setDimensions(_csize.width(), _csize.height());
-            at(x, y).setBackgroundColor(_bg.toColor());
+            setChar(x, y, blank._val);
+            setCharForeground(x, y, blank._fg);
+            setCharBackground(x, y, _bg.toColor());
+            setCharFont(x, y, blank._font);
         }
     }
 }
 
+gtti::atlas::id Console::fontOf(const Console *other, const Tile &t) const
+{
+    gtti::atlas::id f = (t.getFont() ? t.getFont() : other->_font.id());
+
+    return ((f == _font.id()) ? 0 : f);
+}
+
 void Console::apply(Console *other, int x, int y)
 {
     for (int ix = x; (ix < _size.width() && ((ix - x) < other->width())); ix++) {
         for (int iy = y; (iy < _size.height() && ((iy - y) < other->height())); iy++) {
-            Tile o = other->at(ix - x, iy - y);
+            const Tile &o = other->at(ix - x, iy - y);
 
-            at(ix, iy).setChar(o.getChar());
-            at(ix, iy).setForegroundColor(o.getForegroundColor());
-            at(ix, iy).setBackgroundColor(o.getBackgroundColor());
+            setChar(ix, iy, o.getChar());
+            setCharForeground(ix, iy, o.getForegroundColor());
+            setCharBackground(ix, iy, o.getBackgroundColor());
+            setCharFont(ix, iy, fontOf(other, o));
         }
     }
 }
 
-#define BLENDNORM(x) (((float)x) / 255.0f)
-
 void Console::blend(Console *other, int x, int y, float fgBlend, float bgBlend)
 {
+    int fw = (int)(std::max(0.0f, std::min(1.0f, fgBlend)) * 255.0f);
+    int bw = (int)(std::max(0.0f, std::min(1.0f, bgBlend)) * 255.0f);
+
     for (int ix = x; (ix < _size.width() && ((ix - x) < other->width())); ix++) {
         for (int iy = y; (iy < _size.height() && ((iy - y) < other->height())); iy++) {
-            Tile t = at(ix, iy);
-            Tile o = other->at(ix - x, iy - y);
-            Color fgd = t.getForegroundColor();
+            const Tile &t = at(ix, iy);
+            const Tile &o = other->at(ix - x, iy - y);
+
             Color fgs = o.getForegroundColor();
-            Color bgd = t.getBackgroundColor();
             Color bgs = o.getBackgroundColor();
 
-            Color fg, bg;
+            fgs.a = div255(fgs.a * fw);
+            bgs.a = div255(bgs.a * bw);
 
-            fg.a = 255 * (BLENDNORM(fgs.a) + BLENDNORM(fgd.a) * (1 - BLENDNORM(fgs.a)));
-            fg.r = (fgs.r * BLENDNORM(fgs.a) + fgd.r * (BLENDNORM(fgd.a) * (1 - BLENDNORM(fgs.a)))) / BLENDNORM(fg.a);
-            fg.g = (fgs.g * BLENDNORM(fgs.a) + fgd.g * (BLENDNORM(fgd.a) * (1 - BLENDNORM(fgs.a)))) / BLENDNORM(fg.a);
-            fg.b = (fgs.b * BLENDNORM(fgs.a) + fgd.b * (BLENDNORM(fgd.a) * (1 - BLENDNORM(fgs.a)))) / BLENDNORM(fg.a);
+            setChar(ix, iy, o.getChar());
+            setCharFont(ix, iy, fontOf(other, o));
+            setCharForeground(ix, iy, over(t.getForegroundColor(), fgs));
+            setCharBackground(ix, iy, over(t.getBackgroundColor(), bgs));
+        }
+    }
+}
 
-            bg.a = 255 * (BLENDNORM(bgs.a) + BLENDNORM(bgd.a) * (1 - BLENDNORM(bgs.a)));
-            bg.r = (bgs.r * BLENDNORM(bgs.a) + bgd.r * (BLENDNORM(bgd.a) * (1 - BLENDNORM(bgs.a)))) / BLENDNORM(bg.a);
-            bg.g = (bgs.g * BLENDNORM(bgs.a) + bgd.g * (BLENDNORM(bgd.a) * (1 - BLENDNORM(bgs.a)))) / BLENDNORM(bg.a);
-            bg.b = (bgs.b * BLENDNORM(bgs.a) + bgd.b * (BLENDNORM(bgd.a) * (1 - BLENDNORM(bgs.a)))) / BLENDNORM(bg.a);
+void Console::setCharFont(int x, int y, const gtti::font &f)
+{
+    gtti::atlas::id id = f.id();
+
+    // keep the font alive while cells use it
+    if (f && (id != _font.id())) {
+        bool known = false;
 
-            at(ix, iy).setChar(o.getChar());
-            at(ix, iy).setForegroundColor(fg);
-            at(ix, iy).setBackgroundColor(bg);
+        for (const gtti::font &k : _fonts) {
+            if (k.id() == id) known = true;
         }
+
+        if (!known) _fonts.push_back(f);
+    } else {
+        id = 0;
     }
-}
 
-#undef BLENDNORM
+    setCharFont(x, y, id);
+}
 
 void Console::setFilter(Filter *f)
 {
-    if (_filter) {
-        delete _filter;
+    delete _filter;
+    _filter = nullptr;
+
+    addFilter(f);
+}
+
+void Console::addFilter(Filter *f)
+{
+    if (!f) return;
+
+    if (!_filter) {
+        _filter = new FilterChain();
     }
 
-    _filter = f;
+    _filter->add(f);
 }
 
-TileEngine::TileEngine(const char *tileset, int tw, int th, int sw, int sh)
+TileEngine::TileEngine(const char *tileset, int tw, int th, int sw, int sh, gtti::backend *backend) :
+    _backend(backend ? backend : new gtti::raylib_backend())
 {
-    InitWindow(sw * tw, sh * th, "gtti");
+    gtti::backend::setCurrent(_backend);
+    _backend->open(sw * tw, sh * th, "gtti");
 
     _mainConsole = new Console(tileset, tw, th, sw, sh);
+
+    _screen = new Console(*_mainConsole, sw, sh);
+    _screen->setCached(true);
+
     _lastUsedFontSettings.fontName = std::string(tileset);
     _lastUsedFontSettings.charWidth = tw;
     _lastUsedFontSettings.charHeight = th;
-
-    SetTargetFPS(FPS);
 }
 
 TileEngine::~TileEngine()
 {
+    // consoles give their textures back to the backend, so go first
+    delete _screen;
     delete _mainConsole;
-    CloseWindow();
 
-    for (auto l : _layers) {
+    for (const ConsoleLayer &l : _layers) {
         delete l.console;
     }
+
+    gtti::atlas::instance()->unloadTextures();
+    _backend->close();
+
+    if (gtti::backend::current() == _backend) {
+        gtti::backend::setCurrent(nullptr);
+    }
+
+    delete _backend;
 }
 
 Console* TileEngine::layer(const std::string &name) const
 {
-    for (auto l : _layers) {
+    for (const ConsoleLayer &l : _layers) {
         if (l.name == name) {
             return l.console;
         }
@@ -390,33 +817,111 @@ void TileEngine::randomizeTiles()
             bg.g = GetRandomValue(0, 205);
             bg.b = GetRandomValue(0, 205);
 
-            _mainConsole->at(x, y).setChar(GetRandomValue(0, 255));
-            _mainConsole->at(x, y).setForegroundColor(fg);
-            _mainConsole->at(x, y).setBackgroundColor(bg);
+            _mainConsole->setChar(x, y, GetRandomValue(0, 255));
+            _mainConsole->setCharForeground(x, y, fg);
+            _mainConsole->setCharBackground(x, y, bg);
         }
     }
 }
 
 void TileEngine::draw()
 {
-    if (_mainConsole) {
-        _mainConsole->draw();
+    if (!_mainConsole) return;
+
+    const int w = _screen->width();
+
+    _compositor.begin(w, _screen->height());
+
+    if (_mainConsole->_visible) {
+        _compositor.over(_mainConsole->frame(), _mainConsole->_pos.x(), _mainConsole->_pos.y());
     }
 
-    for (auto l : _layers) {
-        if (l.console) {
-            l.console->draw();
+    // layers are ordered by id, so the latest added ends up on top
+    for (const ConsoleLayer &l : _layers) {
+        Console *c = l.console;
+
+        if (c && c->_visible) {
+            _compositor.over(c->frame(), c->_pos.x(), c->_pos.y());
         }
     }
+
+    const FilterBuffer &out = _compositor.end();
+
+    if (_recorder) {
+        _recorder->record(out);
+    }
+
+    present(out);
 }
 
-void TileEngine::run()
+void TileEngine::present(const FilterBuffer &out)
+{
+    if (_backend->cells()) {
+        _backend->present(out);
+        return;
+    }
+
+    const int w = _screen->width();
+
+    if ((out.width != w) || (out.height != _screen->height())) return;
+
+    // only cells which changed since the last frame reach the rasteriser
+    for (int i = 0; i < out.size(); i++) {
+        Icon icon = out.get(i);
+        int x = i % w;
+        int y = i / w;
+
+        _screen->setChar(x, y, icon._val);
+        _screen->setCharForeground(x, y, icon._fg);
+        _screen->setCharBackground(x, y, icon._bg);
+        _screen->setCharFont(x, y, (icon._font == _screen->_font.id()) ? 0 : icon._font);
+    }
+
+    _screen->draw();
+}
+
+bool TileEngine::animating() const
 {
-    while (!WindowShouldClose()) {
-        BeginDrawing();
-        ClearBackground(RAYWHITE);
+    if (_mainConsole && _mainConsole->_visible && _mainConsole->animating()) return true;
+
+    for (const ConsoleLayer &l : _layers) {
+        if (l.console && l.console->_visible && l.console->animating()) return true;
+    }
+
+    return false;
+}
+
+void TileEngine::frame(Color clear)
+{
+    _backend->beginFrame();
+        _backend->clear(clear);
         draw();
-        EndDrawing();
+    _backend->endFrame();
+}
+
+void TileEngine::frame(const FilterBuffer &out, Color clear)
+{
+    _backend->beginFrame();
+        _backend->clear(clear);
+        present(out);
+    _backend->endFrame();
+}
+
+void TileEngine::repeat(Color clear)
+{
+    if (_backend->cells()) return;
+
+    // _screen holds the last frame, and nothing touched it since
+    _backend->beginFrame();
+        _backend->clear(clear);
+        _screen->draw();
+    _backend->endFrame();
+}
+
+void TileEngine::run()
+{
+    while (!closing()) {
+        frame(RAYWHITE);
     }
 }
 
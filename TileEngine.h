@@ -2,92 +2,106 @@
 #define __INCLUDE_TILE_ENGINE_H__
 
 #include "raylib.h"
+#include "backend.h"
+#include "atlas.h"
 #include "geometry.h"
 #include "color.h"
 #include "rnd.h"
 #include "delay.h"
+#include "timewheel.h"
+#include "sys/memstats.h"
 
 #include <string>
 #include <set>
+#include <vector>
 
+namespace gtti { class recorder; }
 class TileEngine;
 
-namespace gtti {
 
-class texture
+struct Icon
 {
-    Texture2D _texture;
-    bool _valid = false;
-public:
-    texture() = default;
-    texture(const texture&) = default;
-    texture(texture&&) = default;
+    unsigned char _val = 0;
+    Color _fg = WHITE;
+    Color _bg = BLANK;
+    gtti::atlas::id _font = 0;  // 0 is the font of the console
+};
 
-    texture(const char *filename) : _valid(true)
-    {
-        _texture = LoadTexture(filename);
-    }
+// A console frame laid out as planes (one array per channel) so filters can
+// run over a whole frame with simple, vectorizable loops
+struct FilterBuffer
+{
+    enum Channel { R = 0, G, B, A, CHANNELS };
 
-    texture(Image img) : _valid(true)
-    {
-        _texture = LoadTextureFromImage(img);
-    }
+    int width = 0;
+    int height = 0;
 
-    ~texture()
-    {
-        unload();
-    }
+    std::vector<unsigned char> glyph;
+    std::vector<gtti::atlas::id> font;
+    std::vector<unsigned char> fg[CHANNELS];
+    std::vector<unsigned char> bg[CHANNELS];
+
+    FilterBuffer() = default;
+    FilterBuffer(const FilterBuffer&) = delete;
+    FilterBuffer& operator=(const FilterBuffer&) = delete;
+    ~FilterBuffer() { resize(0, 0); }
+
+    inline int size() const { return width * height; }
 
-    texture& operator=(const texture&) = default;
-    texture& operator=(texture&&) = default;
+    void resize(int w, int h);
 
+    void set(int i, const Icon &icon);
+    Icon get(int i) const;
+};
+
+// Filters post-process a console frame.  begin() is called once per frame
+// before apply(), which processes the whole buffer
+class Filter
+{
 public:
-    operator Texture2D() const { return _texture; }
-    operator bool() const { return _valid; }
+    Filter() { sys::mem_track(sys::MEM_RENDER, sizeof(Filter)); }
+    virtual ~Filter() { sys::mem_untrack(sys::MEM_RENDER, sizeof(Filter)); }
 
-    void load(const char *filename)
-    {
-        unload();
-        _texture = LoadTexture(filename);
-        _valid = true;
-    }
+    virtual void begin() {}
+    virtual void apply(FilterBuffer &buf) = 0;
 
-    void load(Image img)
-    {
-        unload();
-        _texture = LoadTextureFromImage(img);
-        _valid = true;
-    }
+    // a finished filter is dropped from its chain
+    virtual bool done() const { return false; }
 
-    void unload()
-    {
-        if (_valid) {
-            UnloadTexture(_texture);
-        }
-        _valid = false;
-    }
-};
+    // false while the output stays the same until some deadline, which the
+    // filter then keeps on a Timer so the frame is woken for it
+    virtual bool changing() const { return true; }
 
-} // namespace gtti
+    // helpers for filter kernels
 
-struct Icon
-{
-    unsigned char _val = 0;
-    Color _fg = WHITE;
-    Color _bg = BLANK;
+    // blends every fg and bg color towards c by percent, leaving them opaque
+    static void tint(FilterBuffer &buf, const gtti::Color &c, float percent);
+    // blends one plane towards v, w is the weight of v out of 256
+    static void tint(unsigned char *plane, int n, unsigned char v, int w);
 };
 
-class Filter
+class NoFilter : public Filter
 {
 public:
-    virtual ~Filter() {}
-    virtual Icon operator()(const Icon &, int, int) = 0;
+    inline void apply(FilterBuffer &) {}
 };
 
-class NoFilter : public Filter
+// Runs several filters in sequence, each on the output of the previous one
+class FilterChain : public Filter
 {
+    std::vector<Filter*> _filters;
+
 public:
-    inline Icon operator()(const Icon &i, int, int) { return i; }
+    FilterChain() = default;
+    virtual ~FilterChain();
+
+    void add(Filter *f);
+    inline bool empty() const { return _filters.empty(); }
+
+    void begin();
+    void apply(FilterBuffer &buf);
+    bool done() const { return _filters.empty(); }
+    bool changing() const;
 };
 
 class PsychedlicFilter : public Filter
@@ -97,14 +111,22 @@ class PsychedlicFilter : public Filter
     float blendFreq = 1.0f;
     float alphaFreq = 2.5f;
     ConstantDelay changeTick;
+    Timer _change;
 
     float tick = 0.0f;
 
+    float _alpha = 0.0f;
+    gtti::Color _c;
+
+    // picks a new alpha frequency, returning the ticks until the next one
+    int change();
+
 public:
     PsychedlicFilter();
     virtual ~PsychedlicFilter();
 
-    Icon operator()(const Icon &i, int x, int y);
+    void begin();
+    void apply(FilterBuffer &buf);
 };
 
 class FadeFilter : public Filter
@@ -118,6 +140,7 @@ class FadeFilter : public Filter
     };
 
     ConstantDelay _in, _out, _hold;
+    Timer _holding;
     State _state = FF_OUT;
     float _alpha = 1.0f;
     gtti::Color _c;
@@ -130,26 +153,34 @@ public:
     virtual ~FadeFilter();
 
     bool done() const { return _state == FF_IDLE; }
-    void reset() { _state = FF_OUT; }
+    void reset() { _holding.stop(); _state = FF_OUT; }
+
+    // nothing changes while holding on a timer
+    bool changing() const { return !((_state == FF_HOLD) && _holding.running()); }
 
-    Icon operator()(const Icon &i, int x, int y);
+    void begin();
+    void apply(FilterBuffer &buf);
 };
 
-class ThunderstormFilter : public Filter
+// Flattens console layers into one buffer of cells, bottom layer first.  A
+// layer's background is alpha blended over the cells below it and tints the
+// glyphs under it; a layer's glyph replaces the glyph below.  Colors are
+// kept premultiplied and blended with integer math while compositing
+class Compositor
 {
-    FadeFilter _lightening;
-    ConstantDelay _rain;
-    bool _isRaining = true;
-
-    ConstantDelay _rate;
-    unsigned int _count = 0;
-    unsigned int _tick = 0;
+    FilterBuffer _buf;
 
 public:
-    ThunderstormFilter();
-    virtual ~ThunderstormFilter();
+    Compositor() = default;
+
+    // starts a frame of w x h transparent cells
+    void begin(int w, int h);
+
+    // composites layer over the buffer, with its top left at (x, y) cells
+    void over(const FilterBuffer &layer, int x, int y);
 
-    Icon operator()(const Icon &i, int x, int y);
+    // the flattened frame, valid until the next begin()
+    const FilterBuffer& end();
 };
 
 class Console
@@ -168,6 +199,7 @@ class Console
         inline void setChar(unsigned char v) { _icon._val = v; }
         inline void setForegroundColor(Color fg) { _icon._fg = fg; }
         inline void setBackgroundColor(Color bg) { _icon._bg = bg; }
+        inline void setFont(gtti::atlas::id f) { _icon._font = f; }
 
         Tile(const Tile&) = default;
         Tile(Tile&&) = default;
@@ -176,17 +208,18 @@ class Console
         Tile& operator=(Tile&&) = default;
 
         void setDimensions(int w, int h);
-        void draw(Filter *filter, Texture2D tex, int x, int y) const;
 
         Color getForegroundColor() const { return _icon._fg; }
         Color getBackgroundColor() const { return _icon._bg; }
         unsigned char getChar() const { return _icon._val; }
+        gtti::atlas::id getFont() const { return _icon._font; }
+        const Icon& icon() const { return _icon; }
     };
 
     Console::Tile *_table;
-    gtti::texture _texture;
-    std::string _font;
-    Filter *_filter = nullptr;
+    gtti::font _font;
+    std::vector<gtti::font> _fonts;     // other fonts used by cells
+    FilterChain *_filter = nullptr;
     bool _visible = true;
     gtti::Color _bg = gtti::Color::blank;
 
@@ -194,6 +227,77 @@ class Console
     Size _csize;
     Size _size;
 
+    // per frame draw buffers: the filtered icon of every cell, then one quad
+    // list per texture so each is submitted as a single batch
+    struct Quad
+    {
+        Rectangle dst;
+        Rectangle src;
+        Color color;
+        gtti::backend::handle texture;
+    };
+
+    std::vector<Icon> _frame;
+    FilterBuffer _filtered;
+    std::vector<Quad> _bgQuads;
+    std::vector<Quad> _glyphQuads;
+
+    // the (filtered) icons of every cell as planes
+    const FilterBuffer& frame();
+
+    // builds the quads of the cells in r, offset by origin (in pixels)
+    void build(const Rect &r, float ox, float oy);
+    void submit() const;
+
+    // the offscreen cache of a console holds the icons in _drawn.  Writes
+    // extend the touched bounds; at draw time only touched cells which
+    // differ from _drawn are rasterised again
+    gtti::backend::handle _cache = 0;
+    bool _cached = false;
+    bool _cacheValid = false;
+    std::vector<Icon> _drawn;
+
+    int _touchLeft = 0, _touchTop = 0;
+    int _touchRight = 0, _touchBottom = 0;
+
+    inline void touch(int x, int y)
+    {
+        if (_touchRight <= _touchLeft) {
+            _touchLeft = x; _touchTop = y;
+            _touchRight = x + 1; _touchBottom = y + 1;
+        } else {
+            _touchLeft = std::min(_touchLeft, x);
+            _touchTop = std::min(_touchTop, y);
+            _touchRight = std::max(_touchRight, x + 1);
+            _touchBottom = std::max(_touchBottom, y + 1);
+        }
+    }
+
+    inline void touchAll()
+    {
+        _touchLeft = _touchTop = 0;
+        _touchRight = _size.width();
+        _touchBottom = _size.height();
+    }
+
+    static inline bool same(const Color &a, const Color &b)
+    {
+        return ((a.r == b.r) && (a.g == b.g) && (a.b == b.b) && (a.a == b.a));
+    }
+
+    void updateCache();
+
+    inline Tile& at(int x, int y) { return _table[x + y * _size.width()]; }
+
+    // the font of t (a cell of other) as seen from this console
+    gtti::atlas::id fontOf(const Console *other, const Tile &t) const;
+
+    inline void setCharFont(int x, int y, gtti::atlas::id f)
+    {
+        Tile &t = at(x, y);
+        if (t.getFont() != f) { t.setFont(f); touch(x, y); }
+    }
+
     Console() = delete;
     Console(const Console&) = delete;
     Console(Console&&) = delete;
@@ -205,7 +309,6 @@ public:
     Console(const char *font, int cw, int ch, int sw, int sh);
     ~Console();
 
-    inline Tile& at(int x, int y) { return _table[x + y * _size.width()]; }
     inline const Tile& at(int x, int y) const { return _table[x + y * _size.width()]; }
 
     inline int width() const { return _size.width(); }
@@ -214,17 +317,48 @@ public:
     Point position() const { _pos; }
     void setPosition(const Point &p) { _pos = p; }
 
-    inline void setChar(int x, int y, unsigned char v) { at(x, y).setChar(v); }
-    inline void setCharForeground(int x, int y, Color fg) { at(x, y).setForegroundColor(fg); }
-    inline void setCharBackground(int x, int y, Color bg) { at(x, y).setBackgroundColor(bg); }
+    // each write only marks the cell dirty if it changes it
+    inline void setChar(int x, int y, unsigned char v)
+    {
+        Tile &t = at(x, y);
+        if (t.getChar() != v) { t.setChar(v); touch(x, y); }
+    }
+
+    inline void setCharForeground(int x, int y, Color fg)
+    {
+        Tile &t = at(x, y);
+        if (!same(t.getForegroundColor(), fg)) { t.setForegroundColor(fg); touch(x, y); }
+    }
+
+    inline void setCharBackground(int x, int y, Color bg)
+    {
+        Tile &t = at(x, y);
+        if (!same(t.getBackgroundColor(), bg)) { t.setBackgroundColor(bg); touch(x, y); }
+    }
 
     inline void setBackgroundColor(const gtti::Color &c) { _bg = c;  }
 
+    // draws the glyph of a cell from another font (centered if its glyphs
+    // are smaller than the cells of this console)
+    void setCharFont(int x, int y, const gtti::font &f);
+
     void getCharSize(int *w, int *h);
     void apply(Console *other, int x, int y);
     void blend(Console *other, int x, int y, float fgBlend = 1.0f, float bgBlend = 1.0f);
 
+    // replaces every filter of the console with f
     void setFilter(Filter *f);
+    // stacks f on top of the current filters
+    void addFilter(Filter *f);
+
+    // keeps the console rasterised in an offscreen texture between frames.
+    // Best suited to opaque consoles, or ones with on/off alpha (text)
+    void setCached(bool cached);
+
+    // true if a filter is set
+    inline bool filtered() const { return _filter != nullptr; }
+    // true while a filter changes the console every frame
+    inline bool animating() const { return (_filter != nullptr) && _filter->changing(); }
 
     inline void hide() { _visible = false; }
     inline void show() { _visible = true; }
@@ -255,11 +389,24 @@ class TileEngine
     Console *_mainConsole;
     std::set<ConsoleLayer> _layers; // applied on top of main
 
+    // every visible console is flattened into _screen, which is the only
+    // console actually rasterised
+    Compositor _compositor;
+    Console *_screen;
+
+    gtti::backend *_backend;
+    gtti::recorder *_recorder = nullptr;
+
+    // hands a composited frame to the backend
+    void present(const FilterBuffer &out);
+
     static LastUsedFontSettings _lastUsedFontSettings;
     static unsigned int _layerIds;
 
 public:
-    TileEngine(const char *tileset, int tw, int th, int sw, int sh);
+    // the engine takes ownership of the backend, raylib is used if none is
+    // given
+    TileEngine(const char *tileset, int tw, int th, int sw, int sh, gtti::backend *backend = nullptr);
     ~TileEngine();
 
 public:
@@ -275,6 +422,25 @@ public:
 
     void draw();
 
+    // true while a visible console changes every frame (a filter which is
+    // not just waiting on a timer)
+    bool animating() const;
+
+    // draws every console as one frame on a cleared screen
+    void frame(Color clear);
+    // draws an already composited frame (e.g. a recorded one) instead
+    void frame(const FilterBuffer &out, Color clear);
+    // shows the last frame again as it is, without compositing or recording
+    // it.  Cell backends already show it and are sent nothing
+    void repeat(Color clear);
+
+    // every composited frame is also given to the recorder (not owned, NULL
+    // to stop)
+    void setRecorder(gtti::recorder *r) { _recorder = r; }
+
+    bool closing() const { return _backend->closing(); }
+    gtti::backend* backend() const { return _backend; }
+
     static Console* createConsole(int w, int h);
 
     Console* mainConsole() { return _mainConsole; }
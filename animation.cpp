@@ -310,16 +310,26 @@ void ADSR::initialize(
 
 Animation::Animation(int lifetime, int repeat) :
 	m_done(false), m_lifetime(std::min(1, lifetime)), m_age(0),
-	m_repeat(repeat), m_plays(0), m_delay(NULL)
+	m_repeat(repeat), m_plays(0), m_delay(NULL),
+	m_scheduler(NULL), m_timer(0)
 {
 }
 
 Animation::~Animation()
 {
+	if (m_scheduler) {
+		m_scheduler->cancel(m_timer);
+	}
+
 	delete m_delay;
 }
 
 void Animation::tick()
+{
+	if (!m_scheduler) step();
+}
+
+void Animation::step()
 {
 	if ((!m_done) && (m_delay) && (m_delay->tick())) {
 		onTick();
@@ -341,10 +351,41 @@ bool Animation::done() const
 	return m_done;
 }
 
+int Animation::fire()
+{
+	if ((m_done) || (!m_delay)) return 0;
+
+	// only called when due, so the delay has run out
+	m_delay->skip();
+	step();
+
+	if (m_done) {
+		m_scheduler = NULL;
+		return 0;
+	}
+
+	return m_delay->ticksLeft();
+}
+
+void Animation::schedule(AnimationScheduler* s)
+{
+	if (m_scheduler) {
+		m_scheduler->cancel(m_timer);
+		m_scheduler = NULL;
+	}
+
+	if ((s) && (m_delay) && (!m_done)) {
+		m_scheduler = s;
+		m_timer = s->add(this, m_delay->ticksLeft());
+	}
+}
+
 void Animation::setDelay(Delay* delay)
 {
 	delete m_delay;
 	m_delay = delay;
+
+	schedule(AnimationScheduler::current());
 }
 
 void Animation::setADSR(const ADSR& adsr)
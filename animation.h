@@ -2,6 +2,7 @@
 
 #include "common.h"
 #include "delay.h"
+#include "timewheel.h"
 #include "util.h"
 
 #include <list>
@@ -139,7 +140,11 @@ protected:
 // { id, value,		value,	value,	id }
 // exp: perlin delay:
 //		MULT(10.0,PRLN(RNDN()))
-class Animation
+//
+// Once given a delay an animation registers with the current
+// AnimationScheduler, which runs it only on the ticks its delay triggers.
+// Without one it has to be ticked every frame
+class Animation : public Timed
 {
 public:
 
@@ -149,10 +154,19 @@ public:
 	Animation(int lifetime, int repeat = FOREVER);
 	virtual ~Animation();
 
+	// does nothing while the animation is scheduled
 	virtual void tick();
 	virtual bool done() const;
 
-	// takes ownership of a delay
+	// runs the next step of the animation now, returning the ticks to the
+	// one after (0 when done)
+	int fire();
+
+	// registers with s until done (or destroyed).  Needs a delay
+	void schedule(AnimationScheduler* s);
+
+	// takes ownership of a delay, and schedules with
+	// AnimationScheduler::current() if there is one
 	void setDelay(Delay* delay);
 	Delay* delay() const;
 
@@ -163,6 +177,8 @@ protected:
 
 	virtual void onTick() = 0;
 
+	void step();
+
 	bool m_done;
 	
 	int m_lifetime;
@@ -173,6 +189,9 @@ protected:
 
 	ADSR m_adsr;
 	Delay* m_delay;
+
+	AnimationScheduler* m_scheduler;
+	unsigned int m_timer;
 };
 
 inline
@@ -0,0 +1,259 @@
+#include "atlas.h"
+
+#include "sys/memstats.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace gtti {
+
+const int atlas::sPAGE_SIZE = 512;
+
+atlas* atlas::instance()
+{
+    static atlas a;
+    return &a;
+}
+
+atlas::~atlas()
+{
+    unloadTextures();
+
+    for (page &p : _pages) {
+        sys::mem_untrack(sys::MEM_RENDER, p.pixels.size() * sizeof(::Color));
+    }
+}
+
+int atlas::place(int w, int h, int &x, int &y)
+{
+    for (size_t i = 0; i < _pages.size(); i++) {
+        page &p = _pages[i];
+
+        // on the current shelf
+        if ((p.shelfX + w <= p.width) && (p.shelfY + std::max(p.shelfH, h) <= p.height)) {
+            x = p.shelfX;
+            y = p.shelfY;
+            p.shelfX += w;
+            p.shelfH = std::max(p.shelfH, h);
+            return (int)i;
+        }
+
+        // on a new shelf
+        if ((w <= p.width) && (p.shelfY + p.shelfH + h <= p.height)) {
+            p.shelfY += p.shelfH;
+            p.shelfX = w;
+            p.shelfH = h;
+            x = 0;
+            y = p.shelfY;
+            return (int)i;
+        }
+    }
+
+    // big images get a page of their own
+    page p;
+    p.width = std::max(sPAGE_SIZE, w);
+    p.height = std::max(sPAGE_SIZE, h);
+    p.pixels.assign(p.width * p.height, ::Color{ 0, 0, 0, 0 });
+    p.shelfX = w;
+    p.shelfH = h;
+
+    sys::mem_track(sys::MEM_RENDER, p.pixels.size() * sizeof(::Color));
+
+    _pages.push_back(p);
+
+    x = 0;
+    y = 0;
+
+    return (int)(_pages.size() - 1);
+}
+
+atlas::id atlas::acquire(const char *file, int cw, int ch)
+{
+    if (!file) return 0;
+
+    for (size_t i = 0; i < _fonts.size(); i++) {
+        entry &e = _fonts[i];
+
+        if ((e.file == file) && (e.cw == cw) && (e.ch == ch)) {
+            // a released tileset is still in its page
+            if (e.refs++ == 0) {
+                _pages[e.page].fonts++;
+            }
+            return (id)(i + 1);
+        }
+    }
+
+    Image img = LoadImage(file);
+    if (!img.data) return 0;
+
+    ImageAlphaMask(&img, img);
+
+    // an unused slot, or else the released tileset with the smallest space
+    // the image fits in
+    size_t slot = _fonts.size();
+    size_t reuse = _fonts.size();
+
+    for (size_t i = 0; i < _fonts.size(); i++) {
+        const entry &e = _fonts[i];
+
+        if (e.refs > 0) continue;
+
+        if (e.file.empty()) {
+            slot = std::min(slot, i);
+        } else if ((img.width <= e.w) && (img.height <= e.h) &&
+                   ((reuse == _fonts.size()) || (e.w * e.h < _fonts[reuse].w * _fonts[reuse].h))) {
+            reuse = i;
+        }
+    }
+
+    if (reuse < _fonts.size()) {
+        slot = reuse;
+    } else if (slot >= 255) {
+        // out of ids, the first released tileset gives its slot up (its
+        // space stays in the page)
+        slot = 0;
+        while ((slot < _fonts.size()) && (_fonts[slot].refs > 0)) slot++;
+
+        if (slot >= _fonts.size()) {
+            UnloadImage(img);
+            return 0;
+        }
+    }
+
+    if (slot == _fonts.size()) {
+        _fonts.push_back(entry());
+    }
+
+    entry &e = _fonts[slot];
+    e.file = file;
+    e.cw = cw;
+    e.ch = ch;
+    e.refs = 1;
+
+    if (slot != reuse) {
+        e.page = place(img.width, img.height, e.x, e.y);
+        e.w = img.width;
+        e.h = img.height;
+    }
+
+    page &p = _pages[e.page];
+    ::Color *data = GetImageData(img);
+
+    // a reused space may be bigger than the image
+    if (slot == reuse) {
+        for (int y = 0; y < e.h; y++) {
+            std::fill(p.pixels.begin() + (e.y + y) * p.width + e.x,
+                      p.pixels.begin() + (e.y + y) * p.width + e.x + e.w, ::Color{ 0, 0, 0, 0 });
+        }
+    }
+
+    for (int y = 0; y < img.height; y++) {
+        std::copy(data + y * img.width, data + (y + 1) * img.width,
+                  p.pixels.begin() + (e.y + y) * p.width + e.x);
+    }
+
+    free(data);
+    UnloadImage(img);
+
+    p.fonts++;
+    p.dirty = true;
+
+    return (id)(slot + 1);
+}
+
+void atlas::retain(id f)
+{
+    if (valid(f)) {
+        _fonts[f - 1].refs++;
+    }
+}
+
+void atlas::release(id f)
+{
+    if (!valid(f)) return;
+
+    entry &e = _fonts[f - 1];
+
+    if (--e.refs > 0) return;
+
+    // the pixels stay where they are, for the tileset to be acquired again or
+    // for another one to take its space.  An empty page gives its texture back
+    page &p = _pages[e.page];
+
+    if ((--p.fonts == 0) && p.texture) {
+        if (backend::current()) {
+            backend::current()->unload(p.texture);
+        }
+        p.texture = 0;
+    }
+}
+
+backend::handle atlas::texture(id f)
+{
+    if (!valid(f)) return 0;
+
+    page &p = _pages[_fonts[f - 1].page];
+
+    if (p.dirty || !p.texture) {
+        backend *b = backend::current();
+        if (!b) return 0;
+
+        if (p.texture) {
+            b->unload(p.texture);
+        }
+
+        Image img;
+        img.data = p.pixels.data();
+        img.width = p.width;
+        img.height = p.height;
+        img.mipmaps = 1;
+        img.format = UNCOMPRESSED_R8G8B8A8;
+
+        p.texture = b->loadTexture(img);
+        p.dirty = false;
+    }
+
+    return p.texture;
+}
+
+Rectangle atlas::glyph(id f, unsigned char g) const
+{
+    const entry &e = _fonts[f - 1];
+
+    Rectangle r;
+    r.x = (float)(e.x + e.cw * (g % 16));
+    r.y = (float)(e.y + e.ch * (g / 16));
+    r.width = (float)e.cw;
+    r.height = (float)e.ch;
+
+    return r;
+}
+
+int atlas::glyphWidth(id f) const
+{
+    return (valid(f) ? _fonts[f - 1].cw : 0);
+}
+
+int atlas::glyphHeight(id f) const
+{
+    return (valid(f) ? _fonts[f - 1].ch : 0);
+}
+
+bool atlas::valid(id f) const
+{
+    return ((f > 0) && (f <= _fonts.size()) && (_fonts[f - 1].refs > 0));
+}
+
+void atlas::unloadTextures()
+{
+    backend *b = backend::current();
+
+    for (page &p : _pages) {
+        if (p.texture && b) {
+            b->unload(p.texture);
+        }
+        p.texture = 0;
+    }
+}
+
+} // namespace gtti
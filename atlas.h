@@ -0,0 +1,114 @@
+#ifndef __INCLUDE_ATLAS_H__
+#define __INCLUDE_ATLAS_H__
+
+#include "backend.h"
+
+#include <string>
+#include <vector>
+
+namespace gtti {
+
+// Every tileset (a 16x16 grid of glyphs in one image) is loaded once and
+// packed into a shared atlas page, one texture holding many tilesets.
+// Tilesets are reference counted through gtti::font and referred to by a
+// small id, so cells of different fonts can be drawn from the same texture
+class atlas
+{
+public:
+    typedef unsigned char id;
+
+    static atlas* instance();
+
+    // loads (or shares) the tileset in file with cw x ch glyphs and returns
+    // its id with one reference taken, or 0 if it can not be loaded
+    id acquire(const char *file, int cw, int ch);
+    void retain(id f);
+    void release(id f);
+
+    // the texture of the page holding f (uploaded if it changed)
+    backend::handle texture(id f);
+
+    // where glyph g of f is in its page
+    Rectangle glyph(id f, unsigned char g) const;
+
+    int glyphWidth(id f) const;
+    int glyphHeight(id f) const;
+
+    bool valid(id f) const;
+
+    // drops every page texture (the backend is going away).  They are
+    // uploaded again when next used
+    void unloadTextures();
+
+    static const int sPAGE_SIZE;
+
+protected:
+    atlas() = default;
+    ~atlas();
+
+    struct page
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<::Color> pixels;
+
+        // shelf packing - the current shelf's top, height and free x
+        int shelfY = 0;
+        int shelfH = 0;
+        int shelfX = 0;
+
+        int fonts = 0;
+        backend::handle texture = 0;
+        bool dirty = false;
+    };
+
+    // a released entry (no refs) keeps its file and space, so it can be
+    // acquired again without loading, or its space given to another tileset
+    struct entry
+    {
+        std::string file;
+        int cw = 0;
+        int ch = 0;
+        int refs = 0;
+
+        int page = -1;
+        int x = 0;
+        int y = 0;
+        int w = 0;
+        int h = 0;
+    };
+
+    // finds room for a w x h image, adding a page if needed
+    int place(int w, int h, int &x, int &y);
+
+    std::vector<page> _pages;
+    std::vector<entry> _fonts;      // indexed by id - 1
+};
+
+// A reference to a tileset in the atlas.  Copies share the tileset, which
+// is freed with the last reference
+class font
+{
+    atlas::id _id = 0;
+
+public:
+    font() = default;
+    font(const char *file, int cw, int ch) : _id(atlas::instance()->acquire(file, cw, ch)) {}
+    font(const font &f) : _id(f._id) { atlas::instance()->retain(_id); }
+    ~font() { atlas::instance()->release(_id); }
+
+    font& operator=(const font &f)
+    {
+        atlas::instance()->retain(f._id);
+        atlas::instance()->release(_id);
+        _id = f._id;
+        return *this;
+    }
+
+    atlas::id id() const { return _id; }
+    operator bool() const { return _id != 0; }
+};
+
+} // namespace gtti
+
+#endif
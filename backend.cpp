@@ -0,0 +1,154 @@
+#include "backend.h"
+
+#include "common.h"
+
+namespace gtti {
+
+backend *backend::_current = nullptr;
+
+backend* backend::current()
+{
+    return _current;
+}
+
+void backend::setCurrent(backend *b)
+{
+    _current = b;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+raylib_backend::~raylib_backend()
+{
+    close();
+}
+
+bool raylib_backend::open(int w, int h, const char *title)
+{
+    if (_open) return true;
+
+    InitWindow(w, h, title);
+    SetTargetFPS(FPS);
+
+    _open = true;
+
+    return true;
+}
+
+void raylib_backend::close()
+{
+    if (!_open) return;
+
+    for (auto &t : _textures) {
+        UnloadTexture(t.second);
+    }
+
+    for (auto &t : _targets) {
+        UnloadRenderTexture(t.second);
+    }
+
+    _textures.clear();
+    _targets.clear();
+
+    CloseWindow();
+    _open = false;
+}
+
+bool raylib_backend::closing() const
+{
+    return WindowShouldClose();
+}
+
+backend::handle raylib_backend::loadTexture(Image img)
+{
+    handle h = _next++;
+
+    _textures[h] = LoadTextureFromImage(img);
+
+    return h;
+}
+
+backend::handle raylib_backend::createTarget(int w, int h)
+{
+    handle t = _next++;
+
+    _targets[t] = LoadRenderTexture(w, h);
+
+    return t;
+}
+
+void raylib_backend::unload(handle h)
+{
+    auto t = _textures.find(h);
+    if (t != _textures.end()) {
+        UnloadTexture(t->second);
+        _textures.erase(t);
+        return;
+    }
+
+    auto r = _targets.find(h);
+    if (r != _targets.end()) {
+        UnloadRenderTexture(r->second);
+        _targets.erase(r);
+    }
+}
+
+void raylib_backend::beginFrame()
+{
+    BeginDrawing();
+}
+
+void raylib_backend::endFrame()
+{
+    EndDrawing();
+}
+
+void raylib_backend::beginTarget(handle target)
+{
+    auto r = _targets.find(target);
+    if (r != _targets.end()) {
+        BeginTextureMode(r->second);
+    }
+}
+
+void raylib_backend::endTarget()
+{
+    EndTextureMode();
+}
+
+void raylib_backend::clear(::Color c)
+{
+    ClearBackground(c);
+}
+
+void raylib_backend::fill(const Rectangle &dst, ::Color c)
+{
+    DrawRectangleRec(dst, c);
+}
+
+void raylib_backend::blit(handle texture, const Rectangle &src, const Vector2 &pos, ::Color tint)
+{
+    auto t = _textures.find(texture);
+    if (t != _textures.end()) {
+        DrawTextureRec(t->second, src, pos, tint);
+    }
+}
+
+void raylib_backend::blitTarget(handle target, const Vector2 &pos)
+{
+    auto r = _targets.find(target);
+    if (r == _targets.end()) return;
+
+    // render textures are stored upside down
+    Texture2D tex = r->second.texture;
+    Rectangle src = { 0.0f, 0.0f, (float)tex.width, -(float)tex.height };
+
+    DrawTextureRec(tex, src, pos, ::Color{ 255, 255, 255, 255 });
+}
+
+int raylib_backend::keyPressed()
+{
+    return GetKeyPressed();
+}
+
+} // namespace gtti
@@ -0,0 +1,103 @@
+#ifndef __INCLUDE_BACKEND_H__
+#define __INCLUDE_BACKEND_H__
+
+#include "raylib.h"
+
+#include <map>
+
+struct FilterBuffer;
+
+namespace gtti {
+
+// Everything the tile engine needs from a graphics library: a window (or
+// framebuffer), textures, offscreen targets and two kinds of draw call.
+// Textures and targets are referred to by handle, 0 is never a valid handle
+class backend
+{
+public:
+    typedef unsigned int handle;
+
+    backend() = default;
+    virtual ~backend() {}
+
+    // the backend consoles draw with
+    static backend* current();
+    static void setCurrent(backend *b);
+
+    virtual bool open(int w, int h, const char *title) = 0;
+    virtual void close() = 0;
+
+    // true once the user asked to close the window
+    virtual bool closing() const = 0;
+
+    // textures are created from an image already in memory
+    virtual handle loadTexture(Image img) = 0;
+    virtual handle createTarget(int w, int h) = 0;
+    virtual void unload(handle h) = 0;
+
+    virtual void beginFrame() = 0;
+    virtual void endFrame() = 0;
+
+    // redirects drawing to a target until endTarget()
+    virtual void beginTarget(handle target) = 0;
+    virtual void endTarget() = 0;
+
+    virtual void clear(::Color c) = 0;
+    virtual void fill(const Rectangle &dst, ::Color c) = 0;
+    // draws src of texture at pos, multiplied by tint
+    virtual void blit(handle texture, const Rectangle &src, const Vector2 &pos, ::Color tint) = 0;
+    // draws a whole target at pos
+    virtual void blitTarget(handle target, const Vector2 &pos) = 0;
+
+    // cell based backends (terminals) are handed the final frame of cells
+    // instead of being drawn to
+    virtual bool cells() const { return false; }
+    virtual void present(const FilterBuffer &) {}
+
+    // the next key pressed (raylib key codes), 0 if there is none
+    virtual int keyPressed() = 0;
+
+private:
+    backend(const backend&) = delete;
+    backend& operator=(const backend&) = delete;
+
+    static backend *_current;
+};
+
+// Draws through raylib into an OpenGL window
+class raylib_backend : public backend
+{
+    std::map<handle, Texture2D> _textures;
+    std::map<handle, RenderTexture2D> _targets;
+    handle _next = 1;
+    bool _open = false;
+
+public:
+    raylib_backend() = default;
+    ~raylib_backend();
+
+    bool open(int w, int h, const char *title);
+    void close();
+    bool closing() const;
+
+    handle loadTexture(Image img);
+    handle createTarget(int w, int h);
+    void unload(handle h);
+
+    void beginFrame();
+    void endFrame();
+
+    void beginTarget(handle target);
+    void endTarget();
+
+    void clear(::Color c);
+    void fill(const Rectangle &dst, ::Color c);
+    void blit(handle texture, const Rectangle &src, const Vector2 &pos, ::Color tint);
+    void blitTarget(handle target, const Vector2 &pos);
+
+    int keyPressed();
+};
+
+} // namespace gtti
+
+#endif
@@ -1,4 +1,5 @@
 #include "color.h"
+#include "colorbatch.h"
 #include "util.h"
 
 #include <math.h>
@@ -84,10 +85,6 @@ Color::Color(const ::Color& tc) : m_red(tc.r), m_green(tc.g), m_blue(tc.b), m_al
 {
 }
 
-Color::Color(const Color& copy) : m_red(copy.r()), m_green(copy.g()), m_blue(copy.b()), m_alpha(copy.alpha())
-{
-}
-
 Color::Color(unsigned int rgba)
 {
     m_red = (rgba >> COLOR_RSHIFT) & COLOR_MASK;
@@ -96,20 +93,6 @@ Color::Color(unsigned int rgba)
     m_alpha = (rgba >> COLOR_ASHIFT) & COLOR_MASK;
 }
 
-Color::~Color() {}
-
-Color& Color::operator=(const Color& rhs)
-{
-    if (this != &rhs) {
-        m_red = rhs.m_red;
-        m_green = rhs.m_green;
-        m_blue = rhs.m_blue;
-        m_alpha = rhs.m_alpha;
-    }
-
-    return *this;
-}
-
 bool Color::operator==(const Color& rhs) const
 {
     return ((m_red == rhs.m_red) &&
@@ -631,6 +614,8 @@ Color gradient(int r)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+const int Gradient::sLUT_SIZE = 256;
+
 Gradient::Gradient(const Color& a, const Color& b)
 {
     GradientPoint first, last;
@@ -673,6 +658,8 @@ Gradient::Gradient(int ncolors, ...)
             p.m_value = v;
             p.m_color = Color(va_arg(vl, unsigned int));
 
+            m_points.insert(p);
+
             v += inc;
         }
 
@@ -695,9 +682,35 @@ void Gradient::addColor(const Color& c, float v)
     p.m_color = c;
 
     m_points.insert(p);
+    m_lut.reset();
+}
+
+Gradient& Gradient::bake(int entries)
+{
+    std::vector<Color>* lut = new std::vector<Color>(std::max(2, entries));
+
+    for (size_t i = 0; i < lut->size(); i++) {
+        (*lut)[i] = sample((float)i / (float)(lut->size() - 1));
+    }
+
+    m_lut.reset(lut);
+
+    return *this;
 }
 
 Color Gradient::getColor(float r) const
+{
+    if (m_lut) {
+        int last = (int)m_lut->size() - 1;
+        int i = (int)(std::min(1.0f, std::max(0.0f, r)) * (float)last + 0.5f);
+
+        return (*m_lut)[i];
+    }
+
+    return sample(r);
+}
+
+Color Gradient::sample(float r) const
 {
     std::set<GradientPoint>::const_iterator it = m_points.begin();
 
@@ -724,9 +737,68 @@ Gradient& Gradient::operator=(const Gradient& rhs)
 {
     if (this != &rhs) {
         m_points = rhs.m_points;
+        m_lut = rhs.m_lut;
     }
 
     return *this;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+ColorVariations::ColorVariations() :
+    m_gradientSteps(0), m_hsvSteps(0)
+{
+}
+
+void ColorVariations::bake(const Gradient& g, float satMin, float valueMin, int gradientSteps, int hsvSteps)
+{
+    m_gradientSteps = std::max(2, gradientSteps);
+    m_hsvSteps = std::max(2, hsvSteps);
+
+    m_colors.resize(m_gradientSteps * m_hsvSteps * m_hsvSteps);
+
+    const int n = m_gradientSteps;
+
+    // the gradient steps are scaled together, once per saturation and value
+    std::vector<float> base(3 * n), work(3 * n);
+    std::vector<unsigned char> out(3 * n);
+
+    float* bp[3] = { &base[0], &base[n], &base[2 * n] };
+    float* wp[3] = { &work[0], &work[n], &work[2 * n] };
+    unsigned char* op[3] = { &out[0], &out[n], &out[2 * n] };
+
+    for (int a = 0; a < n; a++) {
+        Color c = g.getColor((float)a / (float)(n - 1));
+
+        bp[0][a] = (float)c.r();
+        bp[1][a] = (float)c.g();
+        bp[2][a] = (float)c.b();
+    }
+
+    for (int s = 0; s < m_hsvSteps; s++) {
+        float sat = satMin + (1.0f - satMin) * (float)s / (float)(m_hsvSteps - 1);
+
+        for (int v = 0; v < m_hsvSteps; v++) {
+            float value = valueMin + (1.0f - valueMin) * (float)v / (float)(m_hsvSteps - 1);
+
+            std::copy(base.begin(), base.end(), work.begin());
+            batch::scaleHSV(wp, sat, value, n);
+            batch::store(wp, op, n);
+
+            for (int a = 0; a < n; a++) {
+                m_colors[(a * m_hsvSteps + s) * m_hsvSteps + v] = Color(op[0][a], op[1][a], op[2][a]);
+            }
+        }
+    }
+}
+
+const Color& ColorVariations::get(float along, float sat, float value) const
+{
+    int a = (int)(std::min(1.0f, std::max(0.0f, along)) * (float)(m_gradientSteps - 1) + 0.5f);
+    int s = (int)(std::min(1.0f, std::max(0.0f, sat)) * (float)(m_hsvSteps - 1) + 0.5f);
+    int v = (int)(std::min(1.0f, std::max(0.0f, value)) * (float)(m_hsvSteps - 1) + 0.5f);
+
+    return m_colors[(a * m_hsvSteps + s) * m_hsvSteps + v];
+}
+
 } // namespace gtti
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include <stdarg.h>
 #include <set>
+#include <vector>
+#include <memory>
 
 namespace gtti {
 
@@ -13,12 +15,12 @@ public:
     Color();
     Color(int r, int g, int b, unsigned char a = 255);
     Color(const ::Color& tc);
-    Color(const Color& copy);
+    Color(const Color& copy) = default;
     Color(unsigned int rgba);	// rgba
 
-    ~Color();
+    ~Color() = default;
 
-    Color& operator=(const Color& rhs);
+    Color& operator=(const Color& rhs) = default;
     bool operator==(const Color& rhs) const;
     bool operator!=(const Color& rhs) const;
 
@@ -216,13 +218,24 @@ public:
     // You can only add colors to the middle (between 0.0 and 1.0)
     void addColor(const Color& c, float v);
 
-    // returns the color along the gradient, r is an element of [0,1]
+    // returns the color along the gradient, r is an element of [0,1].  A
+    // baked gradient looks it up in its table
     Color getColor(float r) const;
 
+    // samples the gradient into a table of entries colors (shared by
+    // copies), adding a color drops it again
+    Gradient& bake(int entries = sLUT_SIZE);
+    bool baked() const { return (m_lut != nullptr); }
+
     Gradient& operator=(const Gradient& rhs);
 
+    static const int sLUT_SIZE;
+
 protected:
 
+    // getColor, without the table
+    Color sample(float r) const;
+
     struct GradientPoint
     {
         float m_value;
@@ -250,6 +263,28 @@ protected:
     };
 
     std::set<GradientPoint> m_points;
+    std::shared_ptr<const std::vector<Color>> m_lut;
+};
+
+// Colors along a gradient with their saturation and value scaled, baked
+// into a table so varied tiles (Dirt) cost a lookup instead of an HSV round
+// trip each.  Coefficients are quantized to steps between min and 1
+class ColorVariations
+{
+public:
+    ColorVariations();
+
+    void bake(const Gradient& g, float satMin, float valueMin, int gradientSteps = 16, int hsvSteps = 8);
+    bool baked() const { return !m_colors.empty(); }
+
+    // along, sat and value are elements of [0,1], sat 0 is satMin
+    const Color& get(float along, float sat, float value) const;
+
+protected:
+
+    std::vector<Color> m_colors;
+    int m_gradientSteps;
+    int m_hsvSteps;
 };
 
 } //namespace gtti
\ No newline at end of file
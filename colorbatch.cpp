@@ -0,0 +1,474 @@
+#include "colorbatch.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef GTTI_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace gtti {
+
+namespace batch {
+
+namespace {
+
+#ifdef GTTI_SIMD_SSE2
+    typedef __m128 vf;
+
+    inline vf load4(const float *p) { return _mm_loadu_ps(p); }
+    inline void store4(float *p, vf v) { _mm_storeu_ps(p, v); }
+    inline vf set4(float f) { return _mm_set1_ps(f); }
+
+    // mask ? a : b
+    inline vf select4(vf mask, vf a, vf b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline vf max3(vf a, vf b, vf c) { return _mm_max_ps(a, _mm_max_ps(b, c)); }
+    inline vf min3(vf a, vf b, vf c) { return _mm_min_ps(a, _mm_min_ps(b, c)); }
+
+    // the factor which scales a color down to 255 by its largest channel
+    inline vf normal4(vf r, vf g, vf b)
+    {
+        vf m = max3(r, g, b);
+        vf big = _mm_cmpgt_ps(m, set4(255.0f));
+        return select4(big, _mm_div_ps(set4(255.0f), _mm_max_ps(m, set4(255.0f))), set4(1.0f));
+    }
+
+    // truncates 4 floats (0-255) into 4 bytes
+    inline void bytes4(unsigned char *p, vf v)
+    {
+        __m128i i = _mm_cvttps_epi32(v);
+        i = _mm_packs_epi32(i, i);
+        i = _mm_packus_epi16(i, i);
+
+        int b = _mm_cvtsi128_si32(i);
+        memcpy(p, &b, 4);
+    }
+#endif
+
+    inline float normal(float r, float g, float b)
+    {
+        float m = std::max(r, std::max(g, b));
+        return ((m > 255.0f) ? 255.0f / m : 1.0f);
+    }
+
+}
+
+void lerp(planes c, const_planes to, float percent, int n)
+{
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        const float *t = to[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf vp = set4(percent);
+
+        for (; i + 4 <= n; i += 4) {
+            vf v = load4(p + i);
+            store4(p + i, _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(load4(t + i), v), vp)));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] += (t[i] - p[i]) * percent;
+        }
+    }
+}
+
+void lerp(planes c, const Color &to, float percent, int n)
+{
+    const float t[3] = { (float)to.r(), (float)to.g(), (float)to.b() };
+
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf vt = set4(t[k]);
+        vf vp = set4(percent);
+
+        for (; i + 4 <= n; i += 4) {
+            vf v = load4(p + i);
+            store4(p + i, _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(vt, v), vp)));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] += (t[k] - p[i]) * percent;
+        }
+    }
+}
+
+void lerp(planes c, const_planes to, const float *percent, int n)
+{
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        const float *t = to[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        for (; i + 4 <= n; i += 4) {
+            vf v = load4(p + i);
+            store4(p + i, _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(load4(t + i), v), load4(percent + i))));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] += (t[i] - p[i]) * percent[i];
+        }
+    }
+}
+
+void blend(planes c, const_planes o, float percent, int n)
+{
+    const float keep = 1.0f - percent;
+
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        const float *s = o[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf vp = set4(percent);
+        vf vk = set4(keep);
+
+        for (; i + 4 <= n; i += 4) {
+            store4(p + i, _mm_add_ps(_mm_mul_ps(load4(s + i), vp), _mm_mul_ps(load4(p + i), vk)));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] = s[i] * percent + p[i] * keep;
+        }
+    }
+}
+
+void multiply(planes c, const_planes m, int n)
+{
+    const float inv = 1.0f / 255.0f;
+
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        const float *s = m[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf vi = set4(inv);
+
+        for (; i + 4 <= n; i += 4) {
+            store4(p + i, _mm_mul_ps(load4(p + i), _mm_mul_ps(load4(s + i), vi)));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] *= s[i] * inv;
+        }
+    }
+}
+
+void multiply(planes c, const Color &m, int n)
+{
+    const float s[3] = { (float)m.r() / 255.0f, (float)m.g() / 255.0f, (float)m.b() / 255.0f };
+
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf vs = set4(s[k]);
+
+        for (; i + 4 <= n; i += 4) {
+            store4(p + i, _mm_mul_ps(load4(p + i), vs));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] *= s[k];
+        }
+    }
+}
+
+void darken(planes c, float percent, int n)
+{
+    // desaturate(1 - percent), then * percent
+    const float keep = 1.0f - percent;
+    float *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+    vf vp = set4(percent);
+    vf vk = set4(keep);
+    vf inv = set4(1.0f / 765.0f);
+
+    for (; i + 4 <= n; i += 4) {
+        vf vr = load4(r + i), vg = load4(g + i), vb = load4(b + i);
+        vf ave = _mm_mul_ps(_mm_add_ps(vr, _mm_add_ps(vg, vb)), inv);
+        vf s = _mm_mul_ps(_mm_add_ps(vp, _mm_mul_ps(ave, vk)), vp);
+
+        store4(r + i, _mm_mul_ps(vr, s));
+        store4(g + i, _mm_mul_ps(vg, s));
+        store4(b + i, _mm_mul_ps(vb, s));
+    }
+#endif
+    for (; i < n; i++) {
+        float ave = (r[i] + g[i] + b[i]) / 765.0f;
+        float s = (percent + ave * keep) * percent;
+
+        r[i] *= s;
+        g[i] *= s;
+        b[i] *= s;
+    }
+}
+
+void darken(planes c, const float *percent, int n)
+{
+    float *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+    vf one = set4(1.0f);
+    vf inv = set4(1.0f / 765.0f);
+
+    for (; i + 4 <= n; i += 4) {
+        vf vp = load4(percent + i);
+        vf vr = load4(r + i), vg = load4(g + i), vb = load4(b + i);
+        vf ave = _mm_mul_ps(_mm_add_ps(vr, _mm_add_ps(vg, vb)), inv);
+        vf s = _mm_mul_ps(_mm_add_ps(vp, _mm_mul_ps(ave, _mm_sub_ps(one, vp))), vp);
+
+        store4(r + i, _mm_mul_ps(vr, s));
+        store4(g + i, _mm_mul_ps(vg, s));
+        store4(b + i, _mm_mul_ps(vb, s));
+    }
+#endif
+    for (; i < n; i++) {
+        float ave = (r[i] + g[i] + b[i]) / 765.0f;
+        float s = (percent[i] + ave * (1.0f - percent[i])) * percent[i];
+
+        r[i] *= s;
+        g[i] *= s;
+        b[i] *= s;
+    }
+}
+
+void clamp(planes c, float lower, float upper, int n)
+{
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf lo = set4(lower);
+        vf hi = set4(upper);
+
+        for (; i + 4 <= n; i += 4) {
+            store4(p + i, _mm_min_ps(hi, _mm_max_ps(lo, load4(p + i))));
+        }
+#endif
+        for (; i < n; i++) {
+            p[i] = std::min(upper, std::max(lower, p[i]));
+        }
+    }
+}
+
+void smooth(planes c, int n)
+{
+    for (int k = 0; k < 3; k++) {
+        float *p = c[k];
+        int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+        vf full = set4(255.0f);
+        vf inv = set4(1.0f / 255.0f);
+
+        for (; i + 4 <= n; i += 4) {
+            vf v = load4(p + i);
+            vf s = _mm_mul_ps(_mm_sqrt_ps(_mm_mul_ps(_mm_max_ps(v, full), inv)), full);
+            store4(p + i, select4(_mm_cmpgt_ps(v, full), s, v));
+        }
+#endif
+        for (; i < n; i++) {
+            if (p[i] > 255.0f) p[i] = sqrtf(p[i] / 255.0f) * 255.0f;
+        }
+    }
+}
+
+void normalize(planes c, int n)
+{
+    float *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+    for (; i + 4 <= n; i += 4) {
+        vf vr = load4(r + i), vg = load4(g + i), vb = load4(b + i);
+        vf s = normal4(vr, vg, vb);
+
+        store4(r + i, _mm_mul_ps(vr, s));
+        store4(g + i, _mm_mul_ps(vg, s));
+        store4(b + i, _mm_mul_ps(vb, s));
+    }
+#endif
+    for (; i < n; i++) {
+        float s = normal(r[i], g[i], b[i]);
+
+        r[i] *= s;
+        g[i] *= s;
+        b[i] *= s;
+    }
+}
+
+void greyscale(planes c, Color::GreyscaleType type, int n)
+{
+    normalize(c, n);
+
+    // the weights follow gtti::Color::greyscale, where LUMINOSITY is the
+    // plain average and AVERAGE is weighted
+    float wr = 1.0f / 3.0f, wg = 1.0f / 3.0f, wb = 1.0f / 3.0f;
+
+    if (type == Color::C_GREY_AVERAGE) {
+        wr = 0.21f;
+        wg = 0.72f;
+        wb = 0.07f;
+    }
+
+    float *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+    vf half = set4(0.5f);
+    vf vwr = set4(wr), vwg = set4(wg), vwb = set4(wb);
+
+    for (; i + 4 <= n; i += 4) {
+        vf vr = load4(r + i), vg = load4(g + i), vb = load4(b + i);
+        vf v;
+
+        if (type == Color::C_GREY_LIGHTNESS) {
+            v = _mm_mul_ps(_mm_add_ps(max3(vr, vg, vb), min3(vr, vg, vb)), half);
+        } else {
+            v = _mm_add_ps(_mm_mul_ps(vr, vwr), _mm_add_ps(_mm_mul_ps(vg, vwg), _mm_mul_ps(vb, vwb)));
+        }
+
+        store4(r + i, v);
+        store4(g + i, v);
+        store4(b + i, v);
+    }
+#endif
+    for (; i < n; i++) {
+        float v;
+
+        if (type == Color::C_GREY_LIGHTNESS) {
+            v = (std::max(r[i], std::max(g[i], b[i])) + std::min(r[i], std::min(g[i], b[i]))) * 0.5f;
+        } else {
+            v = r[i] * wr + g[i] * wg + b[i] * wb;
+        }
+
+        r[i] = v;
+        g[i] = v;
+        b[i] = v;
+    }
+}
+
+void scaleHSV(planes c, float satCoef, float valueCoef, int n)
+{
+    normalize(c, n);
+
+    // with max M and min m, v = M / 255 and s = (M - m) / M, and every
+    // channel is v * (1 - s * (M - x) / (M - m)).  The last term only
+    // depends on the hue, so scaling s and v only needs M and m
+    float *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+    vf zero = _mm_setzero_ps();
+    vf one = set4(1.0f);
+    vf full = set4(255.0f);
+    vf tiny = set4(1e-6f);
+    vf sc = set4(satCoef);
+    vf vc = set4(valueCoef);
+
+    for (; i + 4 <= n; i += 4) {
+        vf vr = load4(r + i), vg = load4(g + i), vb = load4(b + i);
+        vf hi = max3(vr, vg, vb);
+        vf lo = min3(vr, vg, vb);
+        vf delta = _mm_sub_ps(hi, lo);
+
+        vf s = select4(_mm_cmpgt_ps(hi, zero), _mm_div_ps(delta, _mm_max_ps(hi, tiny)), zero);
+        vf v = _mm_min_ps(one, _mm_max_ps(zero, _mm_mul_ps(_mm_div_ps(hi, full), vc)));
+        s = _mm_min_ps(one, _mm_max_ps(zero, _mm_mul_ps(s, sc)));
+
+        // 1 / (M - m), 0 for greys
+        vf chroma = _mm_cmpgt_ps(delta, zero);
+        vf id = select4(chroma, _mm_div_ps(one, _mm_max_ps(delta, tiny)), zero);
+        vf vs = _mm_mul_ps(v, s);
+
+        store4(r + i, _mm_mul_ps(_mm_sub_ps(v, _mm_mul_ps(vs, _mm_mul_ps(_mm_sub_ps(hi, vr), id))), full));
+        store4(g + i, _mm_mul_ps(_mm_sub_ps(v, _mm_mul_ps(vs, _mm_mul_ps(_mm_sub_ps(hi, vg), id))), full));
+        store4(b + i, _mm_mul_ps(_mm_sub_ps(v, _mm_mul_ps(vs, _mm_mul_ps(_mm_sub_ps(hi, vb), id))), full));
+
+    }
+#endif
+    for (; i < n; i++) {
+        float hi = std::max(r[i], std::max(g[i], b[i]));
+        float lo = std::min(r[i], std::min(g[i], b[i]));
+        float delta = hi - lo;
+
+        float s = ((hi > 0.0f) ? delta / hi : 0.0f);
+        float v = std::min(1.0f, std::max(0.0f, hi / 255.0f * valueCoef));
+        s = std::min(1.0f, std::max(0.0f, s * satCoef));
+
+        float id = ((delta > 0.0f) ? 1.0f / delta : 0.0f);
+
+        r[i] = (v - v * s * (hi - r[i]) * id) * 255.0f;
+        g[i] = (v - v * s * (hi - g[i]) * id) * 255.0f;
+        b[i] = (v - v * s * (hi - b[i]) * id) * 255.0f;
+    }
+}
+
+void store(const_planes c, unsigned char* const* out, int n)
+{
+    const float *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+
+#ifdef GTTI_SIMD_SSE2
+    vf zero = _mm_setzero_ps();
+
+    for (; i + 4 <= n; i += 4) {
+        vf vr = load4(r + i), vg = load4(g + i), vb = load4(b + i);
+        vf s = normal4(vr, vg, vb);
+
+        bytes4(out[0] + i, _mm_max_ps(zero, _mm_mul_ps(vr, s)));
+        bytes4(out[1] + i, _mm_max_ps(zero, _mm_mul_ps(vg, s)));
+        bytes4(out[2] + i, _mm_max_ps(zero, _mm_mul_ps(vb, s)));
+    }
+#endif
+    for (; i < n; i++) {
+        float s = normal(r[i], g[i], b[i]);
+
+        out[0][i] = (unsigned char)std::max(0.0f, r[i] * s);
+        out[1][i] = (unsigned char)std::max(0.0f, g[i] * s);
+        out[2][i] = (unsigned char)std::max(0.0f, b[i] * s);
+    }
+}
+
+void load(const ::Color *in, planes c, int n)
+{
+    for (int i = 0; i < n; i++) {
+        c[0][i] = (float)in[i].r;
+        c[1][i] = (float)in[i].g;
+        c[2][i] = (float)in[i].b;
+    }
+}
+
+void store(const_planes c, ::Color *out, unsigned char alpha, int n)
+{
+    for (int i = 0; i < n; i++) {
+        float s = normal(c[0][i], c[1][i], c[2][i]);
+
+        out[i].r = (unsigned char)std::max(0.0f, c[0][i] * s);
+        out[i].g = (unsigned char)std::max(0.0f, c[1][i] * s);
+        out[i].b = (unsigned char)std::max(0.0f, c[2][i] * s);
+        out[i].a = alpha;
+    }
+}
+
+} // namespace batch
+
+} // namespace gtti
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "color.h"
+
+// SSE2 kernels are used where the target has them (every x64 build) unless
+// GTTI_NO_SIMD is defined; everything else runs the scalar loops
+#if !defined(GTTI_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define GTTI_SIMD_SSE2
+#endif
+
+namespace gtti {
+
+// gtti::Color operations over many colors at once.  Colors are held as
+// three float planes (red, green and blue arrays of n elements) which, as
+// with gtti::Color, may go past 255 until they are stored.  Every function
+// works in place on c and gives the same result as the matching gtti::Color
+// method, except that channels are not truncated to int between steps.
+//
+//		float* fg[3] = { r.data(), g.data(), b.data() };
+//		batch::darken(fg, 0.5f, n);
+//		batch::store(fg, out, n);
+//
+namespace batch {
+
+typedef float* const* planes;
+typedef const float* const* const_planes;
+
+// c = c + (to - c) * percent
+void lerp(planes c, const_planes to, float percent, int n);
+void lerp(planes c, const Color &to, float percent, int n);
+// with a percent per color
+void lerp(planes c, const_planes to, const float *percent, int n);
+
+// c = o * percent + c * (1 - percent)
+void blend(planes c, const_planes o, float percent, int n);
+
+// c *= m / 255
+void multiply(planes c, const_planes m, int n);
+void multiply(planes c, const Color &m, int n);
+
+// keeps percent of the color, desaturating it by the rest
+void darken(planes c, float percent, int n);
+void darken(planes c, const float *percent, int n);
+
+void clamp(planes c, float lower, float upper, int n);
+
+// channels past 255 become sqrt(n / 255) * 255
+void smooth(planes c, int n);
+
+// scales colors brighter than 255 down by their largest channel
+void normalize(planes c, int n);
+
+void greyscale(planes c, Color::GreyscaleType type, int n);
+
+// scales the saturation and value of the (normalized) colors, keeping
+// their hue
+void scaleHSV(planes c, float satCoef, float valueCoef, int n);
+
+// normalizes c into byte planes, like gtti::Color::toColor
+void store(const_planes c, unsigned char* const* out, int n);
+
+// loads (from) and stores (to) packed colors
+void load(const ::Color *in, planes c, int n);
+void store(const_planes c, ::Color *out, unsigned char alpha, int n);
+
+} // namespace batch
+
+} // namespace gtti
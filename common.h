@@ -1,10 +1,12 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <assert.h>
 #include "raylib.h"
 
 #include "sys/platform.h"
+#include "sys/memstats.h"
 #include "geometry.h"
 #include "delay.h"
 #include "color.h"
@@ -38,23 +40,18 @@ public:
 		fgColor(c),
 		bgColor(gtti::Color::black),
 		icon(i) {}
-	Tile(const Tile& rhs) { operator=(rhs); }
+	Tile(const Tile& rhs) = default;
 
-	Tile& operator=(const Tile& rhs);
+	Tile& operator=(const Tile& rhs) = default;
 
     gtti::Color fgColor;
     gtti::Color bgColor;
 	int icon;
 };
 
-class BasicModel
-{
-public:
-    BasicModel() {}
-	virtual ~BasicModel() {}
-
-	virtual void reset() = 0;
-};
+// Models are plain structs (no virtual base) so each can be stored in its own
+// contiguous plane (see RenderPlanes) and copied with memcpy.  Every model
+// provides a non-virtual reset().
 
 enum MoibilityFlags
 {
@@ -66,11 +63,10 @@ enum MoibilityFlags
 };
 
 
-class MobilityModel : public BasicModel
+class MobilityModel
 {
 public:
 	MobilityModel() : flags(0) {}
-	~MobilityModel() {}
 
 	unsigned int flags;
 
@@ -97,11 +93,10 @@ enum DiscoveryFlags
 	D_ALREADY_KNOWN		= (D_EXPLORED | D_MAPPED | D_MAGIC_MAPPED),
 };
 
-class DiscoveryModel : public BasicModel
+class DiscoveryModel
 {
 public:
 	DiscoveryModel() : flags(0) {}
-	~DiscoveryModel() {}
 
 	// true if within player viewing range
 	unsigned int flags;
@@ -124,11 +119,10 @@ enum LightingFlags
     L_EMITTER           = B1(5),    // this tile is a light emitter
 };
 
-class LightingModel : public BasicModel
+class LightingModel
 {
 public:
 	LightingModel() : flags(0) {}
-	~LightingModel() {}
 
 	unsigned int flags;
 
@@ -150,11 +144,10 @@ public:
 };
 
 
-class TemperatureModel : public BasicModel
+class TemperatureModel
 {
 public:
 	TemperatureModel() : ambient(0), temp(0) {}
-	~TemperatureModel() {}
 
 	// temperature is a scale from -10 to 10.  The temperature values abs(temp) behave
 	// according to the following chart
@@ -192,14 +185,19 @@ template<typename T>
 class ModelList
 {
 public:
-	ModelList(int w, int h) : m_width(w), m_height(h)
+	ModelList(int w, int h, sys::mem_tag tag = sys::MEM_OTHER) :
+		m_width(w), m_height(h), m_tag(tag)
 	{
 		m_list = new (std::nothrow) T[w * h];
 		assert(m_list);
+
+		sys::mem_track(m_tag, bytes());
 	}
 
 	~ModelList()
 	{
+		sys::mem_untrack(m_tag, bytes());
+
 		delete[] m_list;
 	}
 
@@ -220,7 +218,7 @@ public:
 
 	size_t bytes() const
 	{
-		return (sizeof(T) & size().area());
+		return (sizeof(T) * size().area());
 	}
 
 	const T* get(int x, int y) const
@@ -307,6 +305,8 @@ protected:
 	int m_width;
 	int m_height;
 
+	sys::mem_tag m_tag;
+
 	T* m_list;
 };
 
@@ -326,29 +326,172 @@ typedef ModelList<short> WeightMap;
 
 class Object;
 
-struct RenderGrid
+typedef ModelList<Tile> TileList;
+
+// A view of a single cell across all of the render planes.  The view only
+// holds references, so it is cheap to create on the fly and should not be
+// stored.
+struct RenderCell
 {
-	Tile tile;
-	LightingModel lighting;
-	DiscoveryModel discover;
-	MobilityModel mobility;
-	TemperatureModel temp;
+	RenderCell(Tile& t, LightingModel& l, DiscoveryModel& d,
+			   MobilityModel& m, TemperatureModel& tm) :
+		tile(t), lighting(l), discover(d), mobility(m), temp(tm) {}
+
+	Tile& tile;
+	LightingModel& lighting;
+	DiscoveryModel& discover;
+	MobilityModel& mobility;
+	TemperatureModel& temp;
 };
 
-typedef ModelList<RenderGrid> RenderSettings;
+enum RenderPlane
+{
+	P_TILE			= B1(0),
+	P_LIGHTING		= B1(1),
+	P_DISCOVERY		= B1(2),
+	P_MOBILITY		= B1(3),
+	P_TEMPERATURE	= B1(4),
+
+	// the planes needed to draw a frame
+	P_DRAW			= (P_TILE | P_LIGHTING | P_DISCOVERY),
+	P_ALL			= (P_DRAW | P_MOBILITY | P_TEMPERATURE),
+};
 
-struct Grid
+// The render state of a map stored as component planes: one contiguous array
+// per model.  A pass which only needs one model (the opacity test, a
+// discovery reset, the pathfinder) walks just that plane instead of dragging
+// every model of every cell through the cache.
+class RenderPlanes
 {
-	RenderGrid* render;
+public:
+	RenderPlanes(int w, int h, sys::mem_tag tag = sys::MEM_RENDER) :
+		m_tiles(w, h, tag), m_lighting(w, h, tag), m_discovery(w, h, tag),
+		m_mobility(w, h, tag), m_temperature(w, h, tag) {}
+
+	int width() const { return m_tiles.width(); }
+	int height() const { return m_tiles.height(); }
+	Size size() const { return m_tiles.size(); }
+
+	inline bool inbounds(int x, int y) const { return m_tiles.inbounds(x, y); }
+	inline bool inbounds(const Point& p) const { return m_tiles.inbounds(p); }
+
+	// per-cell access to every plane, (x, y) must be in bounds
+	RenderCell at(int x, int y)
+	{
+		assert(inbounds(x, y));
+
+		return RenderCell(*m_tiles.at(x, y), *m_lighting.at(x, y), *m_discovery.at(x, y),
+						  *m_mobility.at(x, y), *m_temperature.at(x, y));
+	}
+
+	RenderCell at(const Point& p) { return at(p.x(), p.y()); }
+
+	TileList* tiles() { return &m_tiles; }
+	const TileList* tiles() const { return &m_tiles; }
+
+	LightingList* lighting() { return &m_lighting; }
+	const LightingList* lighting() const { return &m_lighting; }
+
+	DiscoveryList* discovery() { return &m_discovery; }
+	const DiscoveryList* discovery() const { return &m_discovery; }
+
+	MobilityList* mobility() { return &m_mobility; }
+	const MobilityList* mobility() const { return &m_mobility; }
+
+	TemperatureList* temperature() { return &m_temperature; }
+	const TemperatureList* temperature() const { return &m_temperature; }
+
+	// copies the given planes (RenderPlane flags) from rhs, which must be the
+	// same size
+	void copy(const RenderPlanes* rhs, unsigned int planes = P_ALL)
+	{
+		if (rhs->size() != size()) return;
+
+		if (planes & P_TILE)		m_tiles.copy(&rhs->m_tiles);
+		if (planes & P_LIGHTING)	m_lighting.copy(&rhs->m_lighting);
+		if (planes & P_DISCOVERY)	m_discovery.copy(&rhs->m_discovery);
+		if (planes & P_MOBILITY)	m_mobility.copy(&rhs->m_mobility);
+		if (planes & P_TEMPERATURE)	m_temperature.copy(&rhs->m_temperature);
+	}
+
+	// copies the given planes of the region r of rhs to the top left of this,
+	// r is clipped to both sizes
+	void copy(const RenderPlanes* rhs, const Rect& r, unsigned int planes)
+	{
+		Rect c(std::max(r.top(), 0), std::max(r.left(), 0),
+			   std::min(r.bottom(), rhs->height()), std::min(r.right(), rhs->width()));
+
+		if ((c.width() > width()) || (c.height() > height())) {
+			c = Rect(c.top(), c.left(), c.top() + std::min(c.height(), height()),
+					 c.left() + std::min(c.width(), width()));
+		}
+
+		if ((c.width() <= 0) || (c.height() <= 0)) return;
 
+		if (planes & P_TILE)		copy(&m_tiles, &rhs->m_tiles, c);
+		if (planes & P_LIGHTING)	copy(&m_lighting, &rhs->m_lighting, c);
+		if (planes & P_DISCOVERY)	copy(&m_discovery, &rhs->m_discovery, c);
+		if (planes & P_MOBILITY)	copy(&m_mobility, &rhs->m_mobility, c);
+		if (planes & P_TEMPERATURE)	copy(&m_temperature, &rhs->m_temperature, c);
+	}
+
+	// resets the models of the given planes inside r, one plane at a time
+	void reset(const Rect& r, unsigned int planes)
+	{
+		if (planes & P_LIGHTING)	reset(&m_lighting, r);
+		if (planes & P_DISCOVERY)	reset(&m_discovery, r);
+		if (planes & P_MOBILITY)	reset(&m_mobility, r);
+		if (planes & P_TEMPERATURE)	reset(&m_temperature, r);
+	}
+
+protected:
+
+	template<typename T>
+	static void copy(ModelList<T>* dst, const ModelList<T>* src, const Rect& r)
+	{
+		for (int y = 0; y < r.height(); y++) {
+			const T* row = src->get(r.left(), r.top() + y);
+
+			std::copy(row, row + r.width(), dst->at(0, y));
+		}
+	}
+
+	template<typename T>
+	static void reset(ModelList<T>* plane, const Rect& r)
+	{
+		for (int y = r.top(); y < r.bottom(); y++) {
+			T* row = plane->at(r.left(), y);
+
+			for (int x = 0; x < r.width(); x++) {
+				row[x].reset();
+			}
+		}
+	}
+
+protected:
+
+	TileList m_tiles;
+	LightingList m_lighting;
+	DiscoveryList m_discovery;
+	MobilityList m_mobility;
+	TemperatureList m_temperature;
+};
+
+typedef RenderPlanes RenderSettings;
+
+// static storage of a map cell, dynamic objects live in the context's
+// EntityStore and the render state in its RenderPlanes
+struct Grid
+{
 	Object* mapObj;
-	Object* dynObj;
 
 	Delay* delay;
 
-	Grid() : render(NULL), mapObj(NULL), dynObj(NULL), delay(NULL) {}
+	Grid() : mapObj(NULL), delay(NULL) {}
 
-	void update();
+	// syncs the render state of the cell with obj, or with the map object if
+	// obj is NULL
+	void sync(RenderCell render, Object* obj = NULL);
 };
 
 typedef ModelList<Grid> TheGrid;
@@ -2,13 +2,17 @@
 
 #include "sys/logger.h"
 
-Context::Context(Console *c, Player *p) :
+Context::Context(Console *c, Player *p, sys::worker_pool* workers) :
 	m_player(p),
 	m_viewport(NULL),
 	m_console(c),
 	m_grid(NULL),
 	m_render(NULL),
-	m_ready(false)
+	m_sight(NULL),
+	m_entities(NULL),
+	m_scheduler(NULL),
+	m_workers(workers),
+	m_snapshots(NULL)
 {
 	sys::mutex_init(&m_mutex);
 }
@@ -19,26 +23,26 @@ Context::~Context()
 
     delete m_console;
 	reset();
+
+	delete m_snapshots.load();
+	for (unsigned int i = 0; i < m_retired.size(); i++) {
+		delete m_retired[i];
+	}
 }
 
 
-void Grid::update()
+void Grid::sync(RenderCell render, Object* obj)
 {
-	Object* obj = dynObj;
-
-	if (Utils::isValid(obj)) {
-		obj->update();
-	} else {
+	if (!Utils::isValid(obj)) {
 		obj = mapObj;
 	}
 
-	render->tile = obj->tile();
-	render->lighting = obj->lightingModel();
-	render->mobility = obj->mobilityModel();
+	render.tile = obj->tile();
+	render.lighting = obj->lightingModel();
+	render.mobility = obj->mobilityModel();
 
-	render->lighting.reset();
-	render->mobility.reset();
-	render->discover.reset();
+	render.lighting.reset();
+	render.mobility.reset();
 }
 
 
@@ -46,34 +50,98 @@ void Context::update()
 {
 	Rect r = m_viewport->render();
 
-	// update objects, creating an accurate lighting map
-	for (int x = r.left(); x < r.width(); x++) {
-		for (int y = r.top(); y < r.height(); y++) {
-			m_grid->at(x, y)->update();
+	// every actor gets its turns for this player turn first
+	m_scheduler->run(this);
+
+	// per-turn state is cleared a plane at a time
+	m_render->reset(r, P_LIGHTING | P_DISCOVERY);
+
+	// only dynamic objects have per-turn behaviour, and only while they are
+	// near the viewport
+	EntityStore::iterator it = m_entities->begin();
+
+	for (; it != m_entities->end(); it++) {
+		if (r.inbounds((*it)->coords())) {
+			(*it)->update();
+			touch((*it)->coords());
 		}
 	}
 
-	m_ready = true;
+	// cells only re-sync when their object changed
+	CellSet::const_iterator c = m_dirty.begin();
+
+	for (; c != m_dirty.end(); c++) {
+		updateCell((*c) % m_grid->width(), (*c) / m_grid->width());
+	}
+
+	m_dirty.clear();
 }
 
-bool Context::place(Object* obj)
+void Context::updateCell(int x, int y)
 {
-	if (Utils::isValid(obj)) {
-        if (m_grid->at(obj->coords())->dynObj) {
-            delete m_grid->at(obj->coords())->dynObj;
-        }
-		m_grid->at(obj->coords())->dynObj = obj;
-        return true;
+	RenderCell c = m_render->at(x, y);
+	unsigned int opacity = (c.lighting.flags & L_TRANSPARENT);
+
+	m_grid->at(x, y)->sync(c, m_entities->get(m_entities->top(x, y)));
+
+	// cached sight lines through this cell are no longer valid
+	if ((c.lighting.flags & L_TRANSPARENT) != opacity) {
+		m_sight->invalidate(x, y);
+	}
+}
+
+void Context::touch(const Point& p)
+{
+	if (m_grid->inbounds(p)) {
+		m_dirty.insert(p.x() + p.y() * m_grid->width());
 	}
+}
+
+EntityHandle Context::place(Object* obj)
+{
+	EntityHandle h = m_entities->add(obj);
+
+	if (h.valid()) {
+		touch(obj->coords());
+		obj->placed(this, h);
+	}
+
+	return h;
+}
+
+bool Context::move(const EntityHandle& h, const Point& to)
+{
+	Object* obj = m_entities->get(h);
+
+	if (!obj || !m_grid->inbounds(to)) return false;
+
+	Point from = obj->coords();
+
+	obj->moveTo(to);
+	m_entities->moved(h);
 
-    return false;
+	// the old cell shows what is left under it, the new one the entity
+	touch(from);
+	touch(to);
+
+	return true;
 }
 
 NamedObject* Context::pickup(const Point& pos)
 {
-    NamedObject *obj = dynamic_cast<NamedObject*>(m_grid->at(pos)->dynObj);
-    m_grid->at(pos)->dynObj = nullptr;
-    return obj;
+	EntityHandle h = m_entities->top(pos);
+
+	for (; h.valid(); h = m_entities->next(h)) {
+		NamedObject *obj = dynamic_cast<NamedObject*>(m_entities->get(h));
+
+		if (obj) {
+			m_entities->release(h);
+			touch(pos);
+			return obj;
+		}
+	}
+
+	return static_cast<NamedObject*>(0);
 }
 
 void Context::lock()
@@ -89,8 +157,13 @@ void Context::unlock()
 void Context::reset()
 {
 	delete m_viewport;
+	delete m_sight;
 	delete m_grid;
 	delete m_render;
+	delete m_scheduler;
+	delete m_entities;
+
+	m_dirty.clear();
 }
 
 
@@ -102,13 +175,30 @@ void Context::initialize(Map* m)
 	// reset the context
 	reset();
 
-	m_grid = new ModelList<Grid>(m->width(), m->height());
+	m_grid = new ModelList<Grid>(m->width(), m->height(), sys::MEM_GRID);
 	m_render = new RenderSettings(m->width(), m->height());
+	m_sight = new LineOfSight(m_render);
+	m_entities = new EntityStore(m->width(), m->height());
+	m_scheduler = new Scheduler(m_workers);
 
 	// create viewport
 	m_viewport = new Viewport(container, window, 25,
 							  m_player->coords().x(), m_player->coords().y());
 
+	// the snapshots outlive a reset, the render thread reads them without
+	// the lock.  One of another size replaces them, the old one is kept
+	// until we are destroyed in case it is still being drawn
+	Size s = m_viewport->viewport().size();
+	SnapshotBuffer* snapshots = m_snapshots.load();
+
+	if (!snapshots ||
+		(snapshots->back()->planes.width() != s.width()) ||
+		(snapshots->back()->planes.height() != s.height())) {
+
+		if (snapshots) m_retired.push_back(snapshots);
+		m_snapshots.store(new SnapshotBuffer(s.width(), s.height()));
+	}
+
     updateMap(m);
 }
 
@@ -119,32 +209,29 @@ void Context::updateMap(Map *m)
         for (int y = 0; y < m->height(); y++) {
             Grid *g = m_grid->at(x, y);
 
-            g->render = m_render->at(x, y);
-
             // update map objects
             g->mapObj = m->staticObject(x, y);
-            g->render->mobility = g->mapObj->mobilityModel();
+            g->sync(m_render->at(x, y), m_entities->get(m_entities->top(x, y)));
         }
     }
+
+    m_sight->clear();
 }
 
-// if we can copy do so, otherwise return immediately
-bool Context::trycopy(RenderSettings *render, Point* playerPos, Tile* playerTile)
+void Context::publish()
 {
-    bool ret = false;
-	if (sys::mutex_trylock(&m_mutex) == 0) {
-		if (m_ready) {
-            render->copy(m_render, Rect(0, 0, m_render->height(), m_render->width()));// m_viewport->viewport());
+	SnapshotBuffer* snapshots = m_snapshots.load();
+	Snapshot* s = snapshots->back();
+	Rect v = m_viewport->viewport();
 
-			*playerPos = m_player->coords() - m_viewport->viewport().topLeft();
-			*playerTile = m_player->tile();
+	// the renderer only reads the planes it draws, and only inside the viewport
+	s->planes.copy(m_render, v, P_DRAW);
 
-			m_ready = false;
-            ret = true;
-		}
-		sys::mutex_unlock(&m_mutex);
-	}
-    return ret;
+	s->viewport = v;
+	s->playerPos = m_player->coords() - v.topLeft();
+	s->playerTile = m_player->tile();
+
+	snapshots->publish();
 }
 
 
@@ -152,7 +239,7 @@ Object* Context::objAt(int x, int y)
 {
 	if (m_grid->inbounds(x, y)) {
 
-		Object* obj = m_grid->at(x, y)->dynObj;
+		Object* obj = m_entities->get(m_entities->top(x, y));
 
 		if (!Utils::isValid(obj)) {
 			obj = m_grid->at(x, y)->mapObj;
@@ -6,12 +6,19 @@
 #include "lighting.h"
 #include "map.h"
 #include "viewport.h"
-#include "effects.h"
+#include "los.h"
+#include "snapshot.h"
+#include "entity.h"
+#include "scheduler.h"
+#include "TileEngine.h"
 
 #include "sys/thread.h"
 
 #include "raylib.h"
 #include <string>
+#include <vector>
+#include <atomic>
+#include <unordered_set>
 
 struct Cursor
 {
@@ -36,14 +43,29 @@ struct Cursor
 class Context
 {
 public:
-	Context(Console *c, Player* p);
+	// the scheduler of every map thinks on workers, if not NULL
+	Context(Console *c, Player* p, sys::worker_pool* workers = NULL);
 	virtual ~Context();
 
 	virtual void update();
 
-	bool place(Object* obj);
+	// adds obj on top of its cell, the context takes ownership, and tells
+	// obj it was placed.  Returns an invalid handle (and does not take
+	// ownership) if obj cannot be placed
+	EntityHandle place(Object* obj);
+
+	// removes the top named object at pos and hands it to the caller
     NamedObject *pickup(const Point& pos);
 
+	// moves a placed entity to another cell, both cells are re-synced on
+	// the next update.  Returns false if h is stale or to is out of bounds
+	bool move(const EntityHandle& h, const Point& to);
+
+	// marks the cell at p as changed, so it is re-synced with its object on
+	// the next update.  Anything which changes an object's tile, lighting or
+	// mobility outside of Object::update() must call this
+	void touch(const Point& p);
+
 	// initializes the context based on the given map
 	void initialize(Map* m);
 
@@ -63,15 +85,35 @@ public:
 
 	ModelList<Grid>* grid();
 
+	// every dynamic object of the context
+	EntityStore* entities();
+
+	// the actors taking turns in this context
+	Scheduler* scheduler();
+
+	// the render state of every cell, stored as component planes
+	RenderPlanes* planes();
+
+	// the shared, cached line-of-sight service for this context
+	LineOfSight* sight();
+
 	Object* objAt(int x, int y);
 	Object* objAt(const Point& p);
 
-	bool trycopy(RenderSettings *render, Point* playerPos, Tile* playerTile);
+	// copies the drawn planes of the viewport (and the player) into a new
+	// snapshot for the renderer, called by the update side after each turn
+	void publish();
+
+	// the latest published snapshot, never blocks.  Only the render thread
+	// may call this
+	const Snapshot* snapshot();
 
 protected:
 
 	void reset();
 
+	void updateCell(int x, int y);
+
 protected:
 
 	Player* m_player;
@@ -82,9 +124,22 @@ protected:
 	TheGrid *m_grid;
 	RenderSettings *m_render;
 
+	LineOfSight *m_sight;
+
+	EntityStore *m_entities;
+	Scheduler *m_scheduler;
+	sys::worker_pool* m_workers;
+
+	typedef std::unordered_set<int> CellSet;
+
+	// cells whose object changed since the last update
+	CellSet m_dirty;
+
+	std::atomic<SnapshotBuffer*> m_snapshots;
+	std::vector<SnapshotBuffer*> m_retired;
+
 	Cursor m_cursor;
 	sys::mutex m_mutex;
-	bool m_ready;
 };
 
 inline
@@ -100,6 +155,38 @@ ModelList<Grid>* Context::grid()
 }
 
 
+inline
+EntityStore* Context::entities()
+{
+	return m_entities;
+}
+
+inline
+Scheduler* Context::scheduler()
+{
+	return m_scheduler;
+}
+
+inline
+RenderPlanes* Context::planes()
+{
+	return m_render;
+}
+
+inline
+LineOfSight* Context::sight()
+{
+	return m_sight;
+}
+
+inline
+const Snapshot* Context::snapshot()
+{
+	SnapshotBuffer* snapshots = m_snapshots.load();
+
+	return (snapshots ? snapshots->front() : static_cast<const Snapshot*>(0));
+}
+
 inline
 Console* Context::console()
 {
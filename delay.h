@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 // The delay class is used to define a delay model for timing animations and
 // particle effects.  The delay class can be ticked each update, then calling
 // delay() will return true if the process should block for the remainder of
@@ -23,6 +25,11 @@ public:
 
 	virtual Delay* copy() const = 0;
 
+	// ticks until the delay next triggers, for the AnimationScheduler
+	int ticksLeft() const { return std::max(1, m_delay - m_count); }
+	// moves the count up so the next tick() triggers
+	void skip() { m_count = std::max(m_count, m_delay - 1); }
+
 protected:
 
 	bool m_ready;
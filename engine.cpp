@@ -8,7 +8,13 @@
 #include "sys/logger.h"
 
 #include "raylib.h"
+#include "swbackend.h"
+#include "terminal.h"
+#include "weather.h"
+
 #include <sstream>
+#include <chrono>
+#include <thread>
 
 struct _mouse
 {
@@ -59,7 +65,10 @@ void UpdateThread::ev_lighting(void *tag, const sys::event_payload::_data& data)
 	if (ut) {
 		ut->block();
 		ut->lighting();
+		ut->m_context->publish();
 		ut->unblock();
+
+		Engine::redraw()->invalidate();
 	}
 }
 
@@ -74,7 +83,7 @@ void UpdateThread::ev_action(void *tag, const sys::event_payload::_data& data)
 			int kc = (int)data.param1;
 
 			// move player - we intend to move, so move
-			if (ut->m_player->move(NEIGHBORS[kc].dx, NEIGHBORS[kc].dy, ut->m_context->grid())) {
+			if (ut->m_player->move(NEIGHBORS[kc].dx, NEIGHBORS[kc].dy, ut->m_context->planes())) {
 				ut->m_context->viewport()->scroll(NEIGHBORS[kc].dx, NEIGHBORS[kc].dy);
 			}
 		}
@@ -101,7 +110,7 @@ void UpdateThread::unblock()
 
 void UpdateThread::lighting()
 {
-	LightingEngine::getInstance()->calculateLighting(m_context->grid(),
+	LightingEngine::getInstance()->calculateLighting(m_context->planes(),
 													 m_context->viewport()->render());
 }
 
@@ -120,13 +129,15 @@ void UpdateThread::update()
 	// update context
 	m_context->update();
 
-//	if (m_emitter) { m_emitter->update(); }
-
 	// calculate lighting
 	lighting();
 
 	// update player
-	m_player->update(m_context->grid());
+	m_player->update(m_context->planes());
+
+	// hand the finished turn to the renderer
+	m_context->publish();
+	Engine::redraw()->invalidate();
 
 #if 0
 	// unlock the context
@@ -159,17 +170,39 @@ Engine *Engine::e = static_cast<Engine*>(0);
 
 Engine::Engine() :
     m_mode(MODE_MOVE),
+	m_workers(NULL),
 	m_updateNeeded(true), m_quit(false)
 {
     printf("EE: begin!\n");
 }
 
-void Engine::init()
+namespace {
+
+	// NULL is the raylib window
+	gtti::backend* createBackend(Engine::Display display)
+	{
+		if (display == Engine::DISPLAY_HEADLESS) {
+			return new gtti::software_backend();
+		} else if (display == Engine::DISPLAY_TERMINAL) {
+			return new gtti::terminal_backend();
+		}
+		return nullptr;
+	}
+
+}
+
+void Engine::init(Display display)
 {
 	e = getInstance();
 
+	// filters and the like keep their deadlines here
+	AnimationScheduler::setCurrent(&e->m_animations);
+
+	gtti::backend* backend = createBackend(display);
+
     printf("EE: creating TileEngine...\n");
-    e->m_engine = new TileEngine("ascii.png", 10, 10, WINDOW_WIDTH, WINDOW_HEIGHT + STATUS_HEIGHT);
+    e->m_engine = new TileEngine("ascii.png", 10, 10, WINDOW_WIDTH, WINDOW_HEIGHT + STATUS_HEIGHT,
+                                 backend);
     printf("EE: done.\n");
 
 	// init game stuff
@@ -182,8 +215,12 @@ void Engine::init()
 	Point p = e->m_map->findNear(Point(41, 25), 4);
 	e->m_player = new Player(p.x(), p.y());
 
+	// actors think on every cpu, the calling thread being one of them
+	sys::worker probe;
+	e->m_workers = new sys::worker_pool(std::max(probe.nCpus() - 1, 1));
+
 	// create context;
-	e->m_context = new Context(e->m_engine->mainConsole(), e->m_player);
+	e->m_context = new Context(e->m_engine->mainConsole(), e->m_player, e->m_workers);
 	e->m_context->initialize(e->m_map);
 
     printf("EE: Initialied console %p\n", e->m_engine->mainConsole());
@@ -200,11 +237,29 @@ void Engine::init()
         e->m_context->place(shroom);
 	}
 
+	// a few wisps drift about the tree, taking their turns with the scheduler
+	for (int i = 0; i < 3; i++) {
+		Wisp *wisp = new Wisp(e->m_map->findNear(tree->coords(), 1));
+
+		if (!e->m_context->place(wisp).valid()) {
+			delete wisp;
+		}
+	}
+
     e->m_context->updateMap(e->m_map);
-    e->m_player->update(e->m_context->grid());
+    e->m_player->update(e->m_context->planes());
 
 	e->m_updateThread = new UpdateThread(e->m_context, e->m_player);
 	e->m_renderThread = new RenderThread(e->m_engine, e->m_context);
+
+#ifdef TORCH_FLICKER
+	// the torch flickers when its delay runs out, not on every update
+	e->m_torch.start(1, [] {
+		int next = e->m_player->flicker();
+		UpdateThread::ev_lighting(e->m_updateThread, sys::event_payload::_data{});
+		return next;
+	});
+#endif
 	e->m_uiThread = new ui::uithread();
 
 	// create some UI stuff
@@ -285,15 +340,21 @@ void Engine::final()
 Engine::~Engine()
 {
     printf("EE: end!\n");
+    m_recorder.close();
     delete m_engine;
 	delete m_map;
 	delete m_player;
 	delete m_context;
+	delete m_workers;
+
+	if (AnimationScheduler::current() == &m_animations) {
+		AnimationScheduler::setCurrent(NULL);
+	}
 }
 
 bool Engine::quit()
 {
-	return e->m_quit;
+	return (e->m_quit || e->m_engine->closing());
 }
 
 InputMode Engine::mode()
@@ -334,26 +395,17 @@ void Engine::drawGround(int x, int y, bool visible, TemperatureModel* tm) const
 //	m_groundEffects->setCharBackground(x, y, bg);
 }
 
-// Bresenham's line algorithm
-// http://members.chello.at/~easyfilter/bresenham.html
+// Bresenham's line algorithm (see Line in los.h)
 void Engine::drawLine(const Point& p0, const Point& p1)
 {
-	int x = p0.x(), y = p0.y();
-	int dx =  abs(p1.x() - x), sx = (x < p1.x() ? 1 : -1);
-	int dy = -abs(p1.y() - y), sy = (y < p1.y() ? 1 : -1);
-	int err = dx + dy, e2;
+	Line l(p0, p1);
 
-	for (;;) {
+	do {
 		// draw(x, y);
 //		m_mapEffects->setCharBackground(x, y, TCODColor::magenta);
 
-		if (!(m_context->grid()->get(x, y)->render->mobility.flags & M_WALKABLE)) break;
-		if ((x == p1.x()) && (y == p1.y())) break;
-
-		e2 = 2 * err;
-		if (e2 >= dy) { err += dy; x += sx; }
-		if (e2 <= dx) { err += dx; y += sy; }
-	}
+		if (!(m_context->planes()->mobility()->get(l.x(), l.y())->flags & M_WALKABLE)) break;
+	} while (l.step());
 }
 
 // Bresenham's circle algorithm
@@ -384,10 +436,135 @@ void Engine::render()
 	// push a render event
 	sys::eventqueue::push(sys::event(sys::EVENT_RENDER, pl));
 #else
-    RenderThread::ev_render(e->m_renderThread, sys::TOKEN_NONE);
+    // only animations which are due run
+    if (e->m_animations.advance() > 0) {
+        e->m_redraw.invalidate();
+    }
+
+    // filters which change every frame keep it dirty, ones only waiting on
+    // a timer were run above
+    if (e->m_engine->animating()) {
+        e->m_redraw.invalidate();
+    }
+
+    if (e->m_redraw.begin()) {
+        RenderThread::ev_render(e->m_renderThread, sys::TOKEN_NONE);
+    } else {
+        e->m_renderThread->present();
+    }
+
+    e->m_redraw.end();
+
+    // the frame is woken for the next animation, including any the filters
+    // started while it was drawn
+    e->m_redraw.wakeAt(e->m_animations.nextWake());
 #endif
 }
 
+void Engine::idle()
+{
+	e->m_redraw.idle();
+}
+
+RedrawScheduler* Engine::redraw()
+{
+	return &e->m_redraw;
+}
+
+int Engine::profile(int frames, const char* image, const char* golden)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	clock::time_point start = clock::now();
+
+	for (int i = 0; i < frames; i++) {
+		// time full frames, not presents
+		e->m_redraw.invalidate();
+		render();
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+	sys::logger::log("EE: %d frames in %.2f ms (%.3f ms/frame)", frames, ms, (frames > 0 ? ms / frames : 0.0));
+
+	gtti::software_backend* sw = dynamic_cast<gtti::software_backend*>(e->m_engine->backend());
+
+	if (sw && image) {
+		sw->save(image);
+	}
+
+	int diff = 0;
+
+	if (golden) {
+		diff = (sw ? sw->compare(golden) : -1);
+
+		sys::logger::log("EE: %d pixels differ from %s", diff, golden);
+	}
+
+	return diff;
+}
+
+void Engine::record(const char* file)
+{
+	if (e->m_recorder.open(file)) {
+		e->m_engine->setRecorder(&e->m_recorder);
+	}
+}
+
+void Engine::replay(const char* file, float speed, Display display)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	gtti::player player;
+	if (!player.open(file)) return;
+
+	TileEngine* engine = new TileEngine("ascii.png", 10, 10, WINDOW_WIDTH, WINDOW_HEIGHT + STATUS_HEIGHT,
+	                                    createBackend(display));
+
+	FilterBuffer frame;
+	unsigned int ms = 0;
+	int frames = 0;
+	double drawMs = 0.0;
+	bool stopped = false;
+
+	// escape (or ^C in a terminal, which raw mode keeps from being a signal)
+	// stops the replay, so keys are polled while waiting for a frame too
+	auto interrupted = [engine, &stopped]() {
+		int key = engine->backend()->keyPressed();
+
+		stopped = stopped || engine->closing() || (key == KEY_ESCAPE);
+		return stopped;
+	};
+
+	while (!interrupted() && player.next(frame, ms)) {
+		if ((speed > 0.0f) && (ms > 0)) {
+			clock::time_point due = clock::now() +
+				std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(ms / speed));
+
+			while (!interrupted() && (clock::now() < due)) {
+				std::this_thread::sleep_for(std::min<clock::duration>(due - clock::now(), std::chrono::milliseconds(20)));
+			}
+
+			if (stopped) break;
+		}
+
+		clock::time_point start = clock::now();
+		engine->frame(frame, BLACK);
+		drawMs += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+		frames++;
+	}
+
+	sys::logger::log("EE: replayed %d frames in %.2f ms (%.3f ms/frame)", frames, drawMs, (frames > 0 ? drawMs / frames : 0.0));
+
+	gtti::software_backend* sw = dynamic_cast<gtti::software_backend*>(engine->backend());
+
+	if (sw) {
+		sw->save("replay.png");
+	}
+
+	delete engine;
+}
 
 void Engine::update(int kc)
 {
@@ -486,9 +663,13 @@ void Engine::checkForInput()
         vis = false;
     }
 
-    int k = GetKeyPressed();
+    int k = e->m_engine->backend()->keyPressed();
     kc = handleKeyDown(k);
 
+    if (k != 0) {
+        e->m_redraw.invalidate();
+    }
+
     if (kc != NNEIGHBORS) {
         if (e->m_mode == MODE_MOVE) {
             sys::event_payload pl;
@@ -520,10 +701,10 @@ void Engine::checkForInput()
 	if (vis) {
 		// describe the object at the current cursor position
 		Object* obj = e->m_context->objAt(mp);
-		TheGrid* g = e->m_context->grid();
+		const DiscoveryList* g = e->m_context->planes()->discovery();
 
 		e->m_uiThread->lock();
-		if ((obj) && (g->get(mp)->render->discover.flags & D_EXPLORED)) {
+		if ((obj) && (g->get(mp)->flags & D_EXPLORED)) {
 			e->m_flavorLabel->setLabel(obj->flavor());
 		} else {
 			e->m_flavorLabel->setLabel("");
@@ -531,6 +712,10 @@ void Engine::checkForInput()
 		e->m_uiThread->unlock();
 	}
 
+	if ((vis != c.visible) || (mp != c.pos)) {
+		e->m_redraw.invalidate();
+	}
+
 	e->m_context->updateCursor(mp, vis);
 
 #if 0
@@ -607,7 +792,7 @@ int Engine::handleKeyDown(int key)
         case 't':
         {
             Torch *t = new Torch(e->m_player->coords().x(), e->m_player->coords().y(), 3, 5);
-            if (!e->m_context->place(t)) {
+            if (!e->m_context->place(t).valid()) {
                 delete t;
             } else {
                 needsUpdate = true;
@@ -634,10 +819,10 @@ int Engine::handleKeyDown(int key)
             break;
         }
         case 'f':
-            e->m_engine->mainConsole()->setFilter(new FadeFilter(0.1f, 0.0f, 0.5f, gtti::Color::white));
+            e->m_engine->mainConsole()->addFilter(new FadeFilter(0.1f, 0.0f, 0.5f, gtti::Color::white));
             break;
         case 'k':
-            e->m_engine->mainConsole()->setFilter(new FadeFilter(0.05f, 0.0f, 0.2f, gtti::Color(255, 96, 96)));
+            e->m_engine->mainConsole()->addFilter(new FadeFilter(0.05f, 0.0f, 0.2f, gtti::Color(255, 96, 96)));
             break;
         case 'l':
             e->m_engine->mainConsole()->setFilter(new ThunderstormFilter());
@@ -664,6 +849,39 @@ int Engine::handleKeyDown(int key)
 			e->m_uiThread->unlock();
 			break;
 		}
+		case KEY_F3:
+			e->m_renderThread->toggleMemory();
+			break;
+		case KEY_F4:
+			sys::mem_dump();
+			e->m_redraw.dump();
+			if (gtti::terminal_backend* t = dynamic_cast<gtti::terminal_backend*>(e->m_engine->backend())) {
+				const gtti::terminal_backend::stats& s = t->statistics();
+				sys::logger::log("-- terminal --");
+				sys::logger::log("  frames       %llu", s.frames);
+				sys::logger::log("  bytes        %llu", s.bytes);
+				sys::logger::log("  last         %zu bytes, %d cells", s.lastBytes, s.lastCells);
+			}
+			break;
+		case KEY_F5:
+			e->m_context->lock();
+			if (!e->m_save.save("gtti.sav", e->m_context, e->m_map, e->m_player)) {
+				e->m_flavorLabel->setLabel("Still saving...");
+			}
+			e->m_context->unlock();
+			break;
+		case KEY_F9:
+			// let a save in progress finish writing first
+			if (!e->m_save.finished()) break;
+
+			e->m_context->lock();
+			if (SaveGame::load("gtti.sav", e->m_context, e->m_map, e->m_player)) {
+				needsUpdate = true;
+			} else {
+				e->m_flavorLabel->setLabel("There is no game to load!");
+			}
+			e->m_context->unlock();
+			break;
 #if 0
 		case TCODK_PRINTSCREEN:
 			TCODSystem::saveScreenshot(NULL);
@@ -12,13 +12,16 @@
 #include "player.h"
 #include "object.h"
 #include "viewport.h"
-#include "effects.h"
 
 #include "ui/ui.h"
 #include "sys/thread.h"
 #include "sys/listener.h"
 #include "context.h"
 #include "render.h"
+#include "savegame.h"
+#include "redraw.h"
+#include "timewheel.h"
+#include "recorder.h"
 
 #include "TileEngine.h"
 
@@ -76,7 +79,14 @@ public:
 	Engine();
 	~Engine();
 
-	static void init();
+	enum Display
+	{
+		DISPLAY_WINDOW = 0,
+		DISPLAY_HEADLESS,	// a software framebuffer instead of a window
+		DISPLAY_TERMINAL	// ANSI escape codes to the terminal (e.g. over ssh)
+	};
+
+	static void init(Display display = DISPLAY_WINDOW);
 	static void final();
     static void run();
 
@@ -90,7 +100,29 @@ public:
 	static void waitingMode();
 	static void restoreMode(const InputMode& m);
 
+    // draws the frame if something asked for it, otherwise only presents
+    // the cached layers again
     static void render();
+
+    // sleeps until the next frame is due
+    static void idle();
+
+    // decides when frames are drawn, see RedrawScheduler
+    static RedrawScheduler* redraw();
+
+    // renders frames and logs the time they took.  A headless engine also
+    // writes the last frame to image (if not NULL) and compares it against
+    // golden (if not NULL), returning the number of pixels which differ (-1
+    // if golden could not be compared, 0 if there was nothing to compare)
+    static int profile(int frames, const char* image, const char* golden = NULL);
+
+    // records every drawn frame to file, see gtti::recorder
+    static void record(const char* file);
+
+    // plays a recording back without a game, speed 1 is as recorded and 0
+    // as fast as possible (logging the time the frames took to draw).  A
+    // headless replay writes its last frame to replay.png
+    static void replay(const char* file, float speed, Display display);
     static void update(int kc);
 
 protected:
@@ -145,6 +177,17 @@ protected:
 	Context* m_context;
     TileEngine *m_engine;
 
+	// started once and shared by the scheduler of every loaded map
+	sys::worker_pool* m_workers;
+
+	SaveGame m_save;
+	RedrawScheduler m_redraw;
+	AnimationScheduler m_animations;
+#ifdef TORCH_FLICKER
+	Timer m_torch;
+#endif
+	gtti::recorder m_recorder;
+
 	bool m_updateNeeded;
     bool m_shownCursor = false;
 	bool m_quit;
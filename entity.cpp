@@ -0,0 +1,152 @@
+#include "entity.h"
+#include "object.h"
+#include "util.h"
+
+const int EntityStore::sNONE = -1;
+
+EntityStore::EntityStore(int w, int h) :
+	m_width(w), m_height(h),
+	m_cells(w * h, sNONE)
+{
+}
+
+EntityStore::~EntityStore()
+{
+	for (unsigned int i = 0; i < m_objects.size(); i++) {
+		delete m_objects[i];
+	}
+}
+
+const EntityStore::Slot* EntityStore::slot(const EntityHandle& h) const
+{
+	// released slots bump their generation, so stale handles never match
+	if ((h.index < m_slots.size()) && (m_slots[h.index].generation == h.generation)) {
+		return &m_slots[h.index];
+	}
+	return static_cast<const Slot*>(0);
+}
+
+EntityHandle EntityStore::add(Object* obj)
+{
+	if (!Utils::isValid(obj)) return EntityHandle();
+
+	Point p = obj->coords();
+	if (!inbounds(p.x(), p.y())) return EntityHandle();
+
+	int s;
+	if (m_free.empty()) {
+		s = (int)m_slots.size();
+		m_slots.push_back(Slot());
+	} else {
+		s = m_free.back();
+		m_free.pop_back();
+	}
+
+	m_slots[s].dense = (unsigned int)m_objects.size();
+	m_objects.push_back(obj);
+	m_slotOf.push_back(s);
+
+	link(s, p.x() + p.y() * m_width);
+
+	return EntityHandle(s, m_slots[s].generation);
+}
+
+Object* EntityStore::release(const EntityHandle& h)
+{
+	if (!slot(h)) return static_cast<Object*>(0);
+
+	Slot& s = m_slots[h.index];
+	Object* obj = m_objects[s.dense];
+
+	unlink(h.index);
+
+	// keep the dense array packed by moving the last entity into the hole
+	unsigned int last = (unsigned int)m_objects.size() - 1;
+	if (s.dense != last) {
+		m_objects[s.dense] = m_objects[last];
+		m_slotOf[s.dense] = m_slotOf[last];
+		m_slots[m_slotOf[s.dense]].dense = s.dense;
+	}
+	m_objects.pop_back();
+	m_slotOf.pop_back();
+
+	// outstanding handles to this slot are now stale (0 is never a valid
+	// generation)
+	if (++s.generation == 0) s.generation = 1;
+	m_free.push_back(h.index);
+
+	return obj;
+}
+
+void EntityStore::destroy(const EntityHandle& h)
+{
+	delete release(h);
+}
+
+void EntityStore::moved(const EntityHandle& h)
+{
+	if (!slot(h)) return;
+
+	Point p = m_objects[m_slots[h.index].dense]->coords();
+	int cell = p.x() + p.y() * m_width;
+
+	if (inbounds(p.x(), p.y()) && (cell != m_slots[h.index].cell)) {
+		unlink(h.index);
+		link(h.index, cell);
+	}
+}
+
+Object* EntityStore::get(const EntityHandle& h) const
+{
+	const Slot* s = slot(h);
+
+	return (s ? m_objects[s->dense] : static_cast<Object*>(0));
+}
+
+EntityHandle EntityStore::top(int x, int y) const
+{
+	if (inbounds(x, y)) {
+		int s = m_cells[x + y * m_width];
+
+		if (s != sNONE) return EntityHandle(s, m_slots[s].generation);
+	}
+	return EntityHandle();
+}
+
+EntityHandle EntityStore::next(const EntityHandle& h) const
+{
+	const Slot* s = slot(h);
+
+	if (s && (s->next != sNONE)) {
+		return EntityHandle(s->next, m_slots[s->next].generation);
+	}
+	return EntityHandle();
+}
+
+void EntityStore::link(int s, int cell)
+{
+	Slot& slot = m_slots[s];
+	int head = m_cells[cell];
+
+	slot.cell = cell;
+	slot.prev = sNONE;
+	slot.next = head;
+
+	if (head != sNONE) m_slots[head].prev = s;
+	m_cells[cell] = s;
+}
+
+void EntityStore::unlink(int s)
+{
+	Slot& slot = m_slots[s];
+
+	if (slot.prev != sNONE) {
+		m_slots[slot.prev].next = slot.next;
+	} else {
+		m_cells[slot.cell] = slot.next;
+	}
+
+	if (slot.next != sNONE) m_slots[slot.next].prev = slot.prev;
+
+	slot.cell = slot.prev = slot.next = sNONE;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "common.h"
+
+#include <vector>
+
+class Object;
+
+// A generation checked reference to an entity in an EntityStore.  A handle
+// to a removed entity never resolves, even if its slot is reused
+struct EntityHandle
+{
+	EntityHandle() : index(0), generation(0) {}
+	EntityHandle(unsigned int i, unsigned int g) : index(i), generation(g) {}
+
+	bool valid() const { return (generation != 0); }
+
+	bool operator==(const EntityHandle& rhs) const
+	{
+		return ((index == rhs.index) && (generation == rhs.generation));
+	}
+
+	bool operator!=(const EntityHandle& rhs) const { return !(*this == rhs); }
+
+	unsigned int index;
+	unsigned int generation;
+};
+
+// The entity store owns every dynamic object of a context.  Objects are kept
+// in a dense array (so per-turn updates walk contiguous memory), looked up
+// through a slot map of generation checked handles, and linked into an
+// intrusive list per map cell for spatial queries.  Any number of entities
+// can share a cell; the most recently added one is on top.
+class EntityStore
+{
+public:
+	typedef std::vector<Object*>::const_iterator iterator;
+
+	EntityStore(int w, int h);
+	~EntityStore();
+
+	// takes ownership of obj and links it into the cell at its coords.
+	// Returns an invalid handle if obj is invalid or out of bounds
+	EntityHandle add(Object* obj);
+
+	// unlinks the entity and hands ownership of it back to the caller
+	Object* release(const EntityHandle& h);
+
+	// removes and deletes the entity
+	void destroy(const EntityHandle& h);
+
+	// relinks the entity into the cell at its current coords
+	void moved(const EntityHandle& h);
+
+	// NULL if the handle is stale
+	Object* get(const EntityHandle& h) const;
+
+	// the top entity of a cell, and the entity below h in the same cell
+	EntityHandle top(int x, int y) const;
+	EntityHandle top(const Point& p) const;
+	EntityHandle next(const EntityHandle& h) const;
+
+	// every live entity, in no particular order
+	iterator begin() const { return m_objects.begin(); }
+	iterator end() const { return m_objects.end(); }
+
+	size_t size() const { return m_objects.size(); }
+
+	bool inbounds(int x, int y) const;
+
+protected:
+
+	static const int sNONE;
+
+	struct Slot
+	{
+		Slot() : dense(0), generation(1), cell(sNONE), prev(sNONE), next(sNONE) {}
+
+		unsigned int dense;
+		unsigned int generation;
+
+		// intrusive cell list
+		int cell;
+		int prev;
+		int next;
+	};
+
+	// the slot of h, or NULL if h is stale
+	const Slot* slot(const EntityHandle& h) const;
+
+	void link(int s, int cell);
+	void unlink(int s);
+
+	int m_width, m_height;
+
+	// dense storage, m_slotOf[i] is the slot of m_objects[i]
+	std::vector<Object*> m_objects;
+	std::vector<int> m_slotOf;
+
+	std::vector<Slot> m_slots;
+	std::vector<int> m_free;
+
+	// head of the entity list of every cell
+	std::vector<int> m_cells;
+};
+
+inline
+EntityHandle EntityStore::top(const Point& p) const
+{
+	return top(p.x(), p.y());
+}
+
+inline
+bool EntityStore::inbounds(int x, int y) const
+{
+	return ((x >= 0) && (x < m_width) && (y >= 0) && (y < m_height));
+}
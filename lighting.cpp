@@ -10,10 +10,12 @@ const int LightingEngine::sMAX_LIGHT_LEVEL = 10;
 
 void LightingEngine::apply_light(void *map, int x, int y, int dx, int dy, void *src)
 {
-	TheGrid* g = (TheGrid *)map;
+	RenderPlanes* g = (RenderPlanes *)map;
 	Light *l = (Light *)src;
 
 	if ((g) && (l) && (g->inbounds(x, y))) {
+		LightingModel* lm = g->lighting()->at(x, y);
+
 		// the lighting calculate is based on a quadratic equation.  It provides
 		// a nice look, while giving a nonlinear fall-off.
 		// It is based on a simple formula
@@ -25,24 +27,64 @@ void LightingEngine::apply_light(void *map, int x, int y, int dx, int dy, void *
 		float dd = FSQR(l->radius);
 		float dr = std::min(dd, FSQR(dx) + FSQR(dy));
 		float coef = (1 - (dr / dd));
-        unsigned int n = g->at(x, y)->render->lighting.lightCount;
+        unsigned int n = lm->lightCount;
 
-        g->at(x, y)->render->lighting.lightCoef = (coef + n * g->at(x, y)->render->lighting.lightCoef) / (n + 1);
-        g->at(x, y)->render->lighting.lightCount++;
-		g->at(x, y)->render->lighting.lightColor += l->color * coef * l->lightLevel;
+        lm->lightCoef = (coef + n * lm->lightCoef) / (n + 1);
+        lm->lightCount++;
+		lm->lightColor += l->color * coef * l->lightLevel;
 
 		if (coef > 0) {
-			g->at(x, y)->render->lighting.flags |= L_LIT;
+			lm->flags |= L_LIT;
+		}
+	}
+}
+
+void LightingEngine::apply_visible(void *map, int x, int y, int dx, int dy, void *src)
+{
+	RenderPlanes* g = (RenderPlanes *)map;
+
+	if ((g) && (g->inbounds(x, y))) {
+		DiscoveryModel* dm = g->discovery()->at(x, y);
+
+		dm->flags |= D_SEEN;
+
+		unsigned int lf = g->lighting()->get(x, y)->flags;
+
+		if ((lf & L_LIT) || (lf & L_ALWAYS_LIT)) {
+			// discovered!
+			dm->flags |= D_EXPLORED;
+		} else {
+			dm->flags |= D_HIDDEN;
+		}
+	}
+}
+
+void LightingEngine::apply_fused(void *map, int x, int y, int dx, int dy, void *src)
+{
+	Light *l = (Light *)src;
+
+	if (l) {
+		// the fused pass walks the larger of the two radii, so each cell is
+		// tested against both.  This is the same test the circle shape uses to
+		// limit each row, so the cells visited match two separate passes
+		int dr = dx * dx + dy * dy;
+
+		if (dr <= l->radius * l->radius) {
+			apply_light(map, x, y, dx, dy, src);
+		}
+
+		if (dr <= l->sight * l->sight) {
+			l->m_visible.push_back(Point(x, y));
 		}
 	}
 }
 
 int LightingEngine::opaque(void *map, int x, int y)
 {
-	TheGrid* g = (TheGrid *)map;
+	const LightingList* g = ((RenderPlanes *)map)->lighting();
 
 	if ((g) && (g->inbounds(x, y))) {
-		return ((g->get(x, y)->render->lighting.flags & L_TRANSPARENT) ? FOV_FALSE : FOV_TRUE);
+		return ((g->get(x, y)->flags & L_TRANSPARENT) ? FOV_FALSE : FOV_TRUE);
 	}
 
 	return FOV_TRUE;
@@ -54,7 +96,11 @@ Light::Light(int x, int y, float level, int rad, const gtti::Color& c) :
 	position(Point(x, y)),
 	color(c),
 	lightLevel(level),
-	radius(rad)
+	radius(rad),
+	sight(0),
+	vision(NULL),
+	viewer(NULL),
+	m_visionReady(false)
 {
 	ray.angle = 0.0f;
 	ray.direction = FOV_NORTH;
@@ -65,15 +111,19 @@ Light::Light(int x, int y, float level, int rad, const gtti::Color& c) :
     fov_settings_set_apply_lighting_function(&m_fov_settings, LightingEngine::apply_light);
 
 	LightingEngine::getInstance()->addLight(this);
+
+	sys::mem_track(sys::MEM_LIGHTING, sizeof(Light));
 }
 
 Light::~Light()
 {
 	LightingEngine::getInstance()->removeLight(this);
 	fov_settings_free(&m_fov_settings);
+
+	sys::mem_untrack(sys::MEM_LIGHTING, sizeof(Light));
 }
 
-void Light::calculateLighting(TheGrid* grid)
+void Light::calculateLighting(RenderPlanes* grid)
 {
 	if (ray.enabled) {
 		fov_beam(&m_fov_settings,
@@ -83,6 +133,16 @@ void Light::calculateLighting(TheGrid* grid)
 				 radius,
 				 ray.direction,
 				 ray.angle);
+	} else if (fused()) {
+		m_visible.clear();
+
+		fov_settings_set_apply_lighting_function(&m_fov_settings, LightingEngine::apply_fused);
+		fov_circle(&m_fov_settings,
+				   grid, this,
+				   position.x(),
+				   position.y(),
+				   std::max(radius, sight));
+		fov_settings_set_apply_lighting_function(&m_fov_settings, LightingEngine::apply_light);
 	} else {
 		fov_circle(&m_fov_settings,
 				   grid, this,
@@ -92,8 +152,32 @@ void Light::calculateLighting(TheGrid* grid)
 	}
 
     // mark ourself as lit
-    grid->at(position)->render->lighting.flags |= L_EMITTER;
-    grid->at(position)->render->lighting.lightColor += color * lightLevel;
+    grid->lighting()->at(position)->flags |= L_EMITTER;
+    grid->lighting()->at(position)->lightColor += color * lightLevel;
+}
+
+void Light::resolveVision(RenderPlanes* grid)
+{
+	if (vision) {
+		PVector::const_iterator it = m_visible.begin();
+
+		for (; it != m_visible.end(); it++) {
+			vision(grid, (*it).x(), (*it).y(),
+				   (*it).x() - position.x(),
+				   (*it).y() - position.y(),
+				   viewer);
+		}
+	}
+
+	m_visionReady = true;
+}
+
+bool Light::consumeVision()
+{
+	bool ret = m_visionReady;
+
+	m_visionReady = false;
+	return ret;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -108,15 +192,26 @@ void LightingEngine::removeLight(Light *l)
 	m_lights.erase(l);
 }
 
-void LightingEngine::calculateLighting(TheGrid* grid, const Rect& renderRect)
+void LightingEngine::calculateLighting(RenderPlanes* grid, const Rect& renderRect)
 {
 	std::set<Light*>::iterator it = m_lights.begin();
+	std::vector<Light*> fused;
 
 	while (it != m_lights.end()) {
 		if (renderRect.inbounds((*it)->position)) {
 			(*it)->calculateLighting(grid);
+
+			if ((*it)->fused()) {
+				fused.push_back(*it);
+			}
 		}
 
 		it++;
 	}
+
+	// visibility depends on the final L_LIT flags, so fused vision can only be
+	// resolved once every light has been applied
+	for (unsigned int i = 0; i < fused.size(); i++) {
+		fused[i]->resolveVision(grid);
+	}
 }
@@ -11,6 +11,11 @@
 
 class Light
 {
+	friend class LightingEngine;
+
+public:
+	typedef void (*vision_func)(void *map, int x, int y, int dx, int dy, void *src);
+
 public:
 	Light(int x, int y, float level, int rad, const gtti::Color& c = gtti::Color::white);
 	~Light();
@@ -34,12 +39,48 @@ public:
 
 	Ray ray;
 
-	void calculateLighting(TheGrid* grid);
+	// the sight radius of the entity carrying this light.  An entity which
+	// both sees and emits light from the same position sets this (and the
+	// vision callback) so its vision is found in the same fov pass as its
+	// light.  The vision callback is called for every visible cell once all
+	// lights have been applied, since visibility depends on L_LIT
+	int sight;
+	vision_func vision;
+	void *viewer;
+
+	void calculateLighting(RenderPlanes* grid);
+
+	// calls the vision callback for every cell seen during the last fused pass
+	void resolveVision(RenderPlanes* grid);
+
+	// returns true (once) if vision was calculated by the last lighting pass
+	bool consumeVision();
+
+	// true if this light can calculate vision in its lighting pass
+	bool fused() const;
+
+	// cells seen during the last fused pass
+	const PVector& visible() const;
 
 protected:
 	fov_settings_type m_fov_settings;
+
+	PVector m_visible;
+	bool m_visionReady;
 };
 
+inline
+bool Light::fused() const
+{
+	return ((sight > 0) && (!ray.enabled));
+}
+
+inline
+const PVector& Light::visible() const
+{
+	return m_visible;
+}
+
 
 // The engine which calculates lighting in game
 class LightingEngine : public Utils::Singleton<LightingEngine>
@@ -51,10 +92,11 @@ public:
 
 	static void apply_visible(void *map, int x, int y, int dx, int dy, void *src);
 	static void apply_light(void *map, int x, int y, int dx, int dy, void *src);
+	static void apply_fused(void *map, int x, int y, int dx, int dy, void *src);
 
 	static int opaque(void *map, int x, int y);
 
-	void calculateLighting(TheGrid* grid, const Rect& renderRect);
+	void calculateLighting(RenderPlanes* grid, const Rect& renderRect);
 
 	void addLight(Light *l);
 	void removeLight(Light *l);
@@ -0,0 +1,163 @@
+#include "los.h"
+#include "scheduler.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+Line::Line(const Point& p0, const Point& p1) :
+	m_x(p0.x()), m_y(p0.y()),
+	m_x1(p1.x()), m_y1(p1.y())
+{
+	m_dx =  abs(m_x1 - m_x);
+	m_dy = -abs(m_y1 - m_y);
+	m_sx = (m_x < m_x1 ? 1 : -1);
+	m_sy = (m_y < m_y1 ? 1 : -1);
+	m_err = m_dx + m_dy;
+}
+
+bool Line::step()
+{
+	if (done()) return false;
+
+	int e2 = 2 * m_err;
+
+	if (e2 >= m_dy) { m_err += m_dy; m_x += m_sx; }
+	if (e2 <= m_dx) { m_err += m_dx; m_y += m_sy; }
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t LineOfSight::sMAX_CACHED = 65536;
+
+LineOfSight::LineOfSight(RenderPlanes* grid) : m_grid(grid)
+{
+}
+
+LineOfSight::~LineOfSight()
+{
+}
+
+uint64_t LineOfSight::key(const Point& a, const Point& b)
+{
+	// order the pair (lexicographically) so (a, b) and (b, a) share an entry
+	bool swap = ((b.x() < a.x()) || ((b.x() == a.x()) && (b.y() < a.y())));
+	const Point& p0 = swap ? b : a;
+	const Point& p1 = swap ? a : b;
+
+	return (((uint64_t)(p0.x() & 0xffff) << 48) |
+			((uint64_t)(p0.y() & 0xffff) << 32) |
+			((uint64_t)(p1.x() & 0xffff) << 16) |
+			((uint64_t)(p1.y() & 0xffff)));
+}
+
+bool LineOfSight::trace(const RenderPlanes* grid, const Point& from, const Point& to)
+{
+	const LightingList* lighting = grid->lighting();
+	Line l(from, to);
+
+	while (l.step()) {
+		// the end of the ray can be seen even if it is opaque
+		if (l.done()) break;
+
+		if (!lighting->inbounds(l.x(), l.y())) return false;
+		if (!(lighting->get(l.x(), l.y())->flags & L_TRANSPARENT)) return false;
+	}
+
+	return true;
+}
+
+bool LineOfSight::sees(const RenderPlanes* grid, const Point& a, const Point& b)
+{
+	// bresenham lines are not symmetric, so a pair is visible if either
+	// direction is clear
+	return ((a == b) || trace(grid, a, b) || trace(grid, b, a));
+}
+
+bool LineOfSight::los(const Point& a, const Point& b)
+{
+	assert(!Scheduler::thinking());
+
+	if (a == b) return true;
+
+	flush();
+
+	uint64_t k = key(a, b);
+	Cache::const_iterator it = m_cache.find(k);
+
+	if (it != m_cache.end()) {
+		return it->second.visible;
+	}
+
+	Entry e;
+	e.visible = sees(m_grid, a, b);
+	e.bounds = Rect(std::min(a.y(), b.y()), std::min(a.x(), b.x()),
+					std::max(a.y(), b.y()) + 1, std::max(a.x(), b.x()) + 1);
+
+	if (m_cache.size() >= sMAX_CACHED) {
+		m_cache.clear();
+	}
+
+	m_cache[k] = e;
+
+	return e.visible;
+}
+
+int LineOfSight::los(const Point& source, const PVector& targets, std::vector<bool>& visible)
+{
+	int count = 0;
+
+	visible.resize(targets.size());
+
+	for (unsigned int i = 0; i < targets.size(); i++) {
+		visible[i] = los(source, targets[i]);
+
+		if (visible[i]) count++;
+	}
+
+	return count;
+}
+
+void LineOfSight::invalidate(int x, int y)
+{
+	assert(!Scheduler::thinking());
+
+	if (!m_cache.empty()) {
+		m_dirty.push_back(Point(x, y));
+	}
+}
+
+void LineOfSight::clear()
+{
+	m_cache.clear();
+	m_dirty.clear();
+}
+
+void LineOfSight::flush()
+{
+	if (m_dirty.empty()) return;
+
+	Cache::iterator it = m_cache.begin();
+
+	while (it != m_cache.end()) {
+		bool stale = false;
+
+		for (unsigned int i = 0; i < m_dirty.size(); i++) {
+			if (it->second.bounds.inbounds(m_dirty[i])) {
+				stale = true;
+				break;
+			}
+		}
+
+		if (stale) {
+			it = m_cache.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	m_dirty.clear();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "geometry.h"
+#include "common.h"
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+// Bresenham's line algorithm
+// http://members.chello.at/~easyfilter/bresenham.html
+//
+// steps from p0 to p1 (inclusive) one cell at a time:
+//
+//		Line l(p0, p1);
+//		do {
+//			draw(l.x(), l.y());
+//		} while (l.step());
+//
+class Line
+{
+public:
+	Line(const Point& p0, const Point& p1);
+
+	inline int x() const { return m_x; }
+	inline int y() const { return m_y; }
+
+	inline Point point() const { return Point(m_x, m_y); }
+
+	// true if the current cell is the end of the line
+	inline bool done() const { return ((m_x == m_x1) && (m_y == m_y1)); }
+
+	// advances to the next cell, returns false if the end was already reached
+	bool step();
+
+protected:
+	int m_x, m_y;
+	int m_x1, m_y1;
+	int m_dx, m_dy;
+	int m_sx, m_sy;
+	int m_err;
+};
+
+// The line-of-sight service answers "can A see B" against the opacity of
+// the grid (the same L_TRANSPARENT test the lighting engine uses).  Queries
+// are symmetric - los(a, b) == los(b, a) - and cached per pair of cells.  A
+// cached result is dropped when the opacity of a cell inside the bounding
+// box of its ray changes.
+//
+// Queries update the cache, so they only run on one thread at a time and
+// never inside Actor::think(), which runs in parallel - actors test sight
+// with sees() there and use the cache in act().
+class LineOfSight
+{
+public:
+	explicit LineOfSight(RenderPlanes* grid);
+	~LineOfSight();
+
+	// true if a can see b (and b can see a)
+	bool los(const Point& a, const Point& b);
+
+	// batched query from one source - visible[i] is set for targets[i].  Returns
+	// the number of visible targets
+	int los(const Point& source, const PVector& targets, std::vector<bool>& visible);
+
+	// notifies the service the opacity of (x, y) changed
+	void invalidate(int x, int y);
+	void invalidate(const Point& p);
+
+	// drops every cached result (the whole grid changed)
+	void clear();
+
+	size_t cached() const { return m_cache.size(); }
+
+	// the uncached, one directional ray test - true if every cell strictly
+	// between from and to is transparent
+	static bool trace(const RenderPlanes* grid, const Point& from, const Point& to);
+
+	// the uncached los() test, which only reads grid
+	static bool sees(const RenderPlanes* grid, const Point& a, const Point& b);
+
+protected:
+
+	struct Entry
+	{
+		Rect bounds;
+		bool visible;
+	};
+
+	typedef std::unordered_map<uint64_t, Entry> Cache;
+
+	static uint64_t key(const Point& a, const Point& b);
+
+	// removes every entry whose ray crosses a dirty cell
+	void flush();
+
+	static const size_t sMAX_CACHED;
+
+	RenderPlanes* m_grid;
+
+	Cache m_cache;
+	PVector m_dirty;
+};
+
+inline
+void LineOfSight::invalidate(const Point& p)
+{
+	invalidate(p.x(), p.y());
+}
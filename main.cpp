@@ -1,4 +1,6 @@
 #include <time.h>
+#include <string.h>
+#include <stdlib.h>
 
 #include "engine.h"
 #include "rnd.h"
@@ -11,15 +13,59 @@
 
 int main(int argc, char **argv)
 {
+    // --headless [frames] renders frames into a software framebuffer,
+    // logs how long they took and saves the last one to headless.png
+    // --terminal plays in the terminal instead of a window
+    // --record file writes every frame drawn to file
+    // --replay file [speed] plays a recording back instead of the game
+    // --seed n generates the same map on every run
+    // --compare golden.png compares the last headless frame against an image,
+    // exiting with 1 if any pixel differs
+    int headless = 0;
+    const char *record = NULL;
+    const char *replay = NULL;
+    const char *golden = NULL;
+    float speed = 1.0f;
+    uint32_t seed = (uint32_t)time(NULL);
+    Engine::Display display = Engine::DISPLAY_WINDOW;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = ((i + 1 < argc) ? atoi(argv[i + 1]) : 0);
+            if (headless <= 0) headless = 100;
+            display = Engine::DISPLAY_HEADLESS;
+        } else if (strcmp(argv[i], "--terminal") == 0) {
+            display = Engine::DISPLAY_TERMINAL;
+        } else if ((strcmp(argv[i], "--record") == 0) && (i + 1 < argc)) {
+            record = argv[++i];
+        } else if ((strcmp(argv[i], "--replay") == 0) && (i + 1 < argc)) {
+            replay = argv[++i];
+            if ((i + 1 < argc) && (argv[i + 1][0] != '-')) speed = (float)atof(argv[++i]);
+        } else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if ((strcmp(argv[i], "--compare") == 0) && (i + 1 < argc)) {
+            golden = argv[++i];
+        }
+    }
+
     sys::logger::createLogger("gtti.log");
     sys::eventqueue::createEventQueue();
 
-    Rnd::seed(time(NULL));
+    Rnd::seed(seed);
+
+    if (replay) {
+        Engine::replay(replay, speed, display);
+        return 0;
+    }
 
 #ifndef TEST
     printf("EE: go!\n");
 
-    Engine::init();
+    Engine::init(display);
+
+    if (record) {
+        Engine::record(record);
+    }
 #else
     sys::eof::PETest();
 #endif
@@ -27,12 +73,19 @@ int main(int argc, char **argv)
 
     printf("EE: run!\n");
 
-    while (!Engine::quit() && !WindowShouldClose()) {
-        Engine::checkForInput();
-        Engine::render();
+    int result = 0;
+
+    if (headless > 0) {
+        result = (Engine::profile(headless, "headless.png", golden) != 0) ? 1 : 0;
+    } else {
+        while (!Engine::quit()) {
+            Engine::checkForInput();
+            Engine::render();
+            Engine::idle();
+        }
     }
 
 	Engine::final();
 
-	return 0;
+	return result;
 }
@@ -17,10 +17,14 @@ Dirt::Dirt(int x, int y) : Object(x, y, ' ', gtti::Color::black)
 	//litColor	= TCODColor::lerp(TCODColor::darkSepia, TCODColor::desaturatedGreen, Rnd::rndn());
 	
 
-    gtti::Color fg = gtti::Color::lerp(gtti::Color(94, 75, 47), gtti::Color(63, 127, 95), Rnd::rndn());
-	fg.scaleHSV(Rnd::betweenf(0.6f, 1.0f), Rnd::betweenf(0.6f, 1.0f));
+	// lerp(a, b, rndn()), then scaleHSV(between(0.6, 1), between(0.6, 1))
+	static gtti::ColorVariations fg;
 
-	m_fgColor = gtti::Color(fg);
+	if (!fg.baked()) {
+		fg.bake(gtti::Gradient(gtti::Color(94, 75, 47), gtti::Color(63, 127, 95)), 0.6f, 0.6f);
+	}
+
+	m_fgColor = fg.get(Rnd::rndn(), Rnd::rndn(), Rnd::rndn());
 	m_bgColor = gtti::Color(gtti::Color::lerp(gtti::Color(12, 8, 4), gtti::Color(0, 8, 4), Rnd::rndn()));
 	
 	m_icon = icons[Rnd::between(0, 3)];
@@ -28,7 +32,7 @@ Dirt::Dirt(int x, int y) : Object(x, y, ' ', gtti::Color::black)
 	m_mobilityModel.flags |= (M_WALKABLE | M_JUMPABLE | M_REACHABLE);
 	m_lightingModel.flags |= L_TRANSPARENT;
 
-	m_flavor = std::string("the ground");
+	m_flavor = "the ground";
 }
 
 Grass::Grass(const Point& p) : Object(p, ' ', gtti::Color::black)
@@ -43,7 +47,7 @@ Grass::Grass(const Point& p) : Object(p, ' ', gtti::Color::black)
 	m_mobilityModel.flags |= (M_WALKABLE | M_JUMPABLE | M_REACHABLE);
 	m_lightingModel.flags |= L_TRANSPARENT;
 
-	m_flavor = std::string("grassy turf");
+	m_flavor = "grassy turf";
 }
 
 
@@ -52,7 +56,7 @@ Wall::Wall(int x, int y) : Object(x, y, '#', gtti::Color::lerp(gtti::Color::grey
 {
 	m_bgColor = gtti::Color::lerp(gtti::Color(12, 12, 12), gtti::Color(0, 12, 24), 0.40f);
 
-	m_flavor = std::string("a rough stone wall");
+	m_flavor = "a rough stone wall";
 }
 
 FloraWall::FloraWall(const Point& p) : Object(p, '#', gtti::Color(121, 110, 64))
@@ -60,10 +64,10 @@ FloraWall::FloraWall(const Point& p) : Object(p, '#', gtti::Color(121, 110, 64))
 	m_fgColor = gtti::Color::lerp(gtti::Color(35, 41, 22), gtti::Color(59, 77, 22), Rnd::rndn());
 	m_bgColor = gtti::Color::lerp(gtti::Color(6, 6, 0), gtti::Color(0, 12, 0), Rnd::betweenf(0.3f, 0.6f));
 
-	m_flavor = std::string("an overgrowth of roots, vines, and moss cover a stone wall");
+	m_flavor = "an overgrowth of roots, vines, and moss cover a stone wall";
 }
 
-Torch::Torch(int x, int y, int level, int rad) : NamedObject("torch", x, y, 'i', gtti::Color::gold)
+Torch::Torch(int x, int y, float level, int rad) : NamedObject("torch", x, y, 'i', gtti::Color::gold)
 {
 	m_light = new Light(x, y, level, rad);
 
@@ -80,19 +84,6 @@ Torch::~Torch()
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Tile& Tile::operator=(const Tile& rhs)
-{
-	if (this != &rhs) {
-		icon	= rhs.icon;
-		fgColor	= rhs.fgColor;
-		bgColor	= rhs.bgColor;
-	}
-
-	return *this;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-
 const std::string Map::Rules[] =
 {
 	"B1/S1",			//  0 gnarl
@@ -159,9 +150,15 @@ Map::Rule Map::fromString(const std::string& rule)
 
 Map::Map(int w, int h) :
 	m_width(w), m_height(h),
-	m_grid(w, h),
+	m_grid(w, h, sys::MEM_MAP),
 	m_staticObjects(w * h, static_cast<Object*>(0)),
-	m_distMap(w, h)
+	m_staticKinds(w * h, K_NONE),
+	m_arena(sizeof(Wall) * w * h, sys::MEM_MAP),
+	m_dirt(&m_arena),
+	m_walls(&m_arena),
+	m_flora(&m_arena),
+	m_grass(&m_arena),
+	m_distMap(w, h, sys::MEM_MAP)
 {
 	// initialize map
 #if 0
@@ -210,6 +207,11 @@ void Map::generateMap()
 Map::~Map()
 {
 	fov_settings_free(&m_fov_settings);
+
+	// run the destructors, the arena releases the memory in one go
+	for (int i = 0; i < (int)m_staticObjects.size(); i++) {
+		releaseStatic(i);
+	}
 }
 
 bool Map::isWall(int x, int y) const
@@ -222,49 +224,102 @@ bool Map::isWall(int x, int y) const
 }
 
 void Map::setWall(int x, int y, bool iswall)
+{
+	if (inbounds(x, y)) {
+		setStatic(x, y, (iswall ? K_WALL : K_DIRT));
+	}
+}
+
+void Map::setStatic(int x, int y, StaticKind kind)
 {
 	int i = x + y * m_width;
+	Object* obj = static_cast<Object*>(0);
 
-	if (inbounds(x, y)) {
-		delete m_staticObjects[i];
+	releaseStatic(i);
 
-		if (iswall) {
-			m_staticObjects[i] = new Wall(x, y);
-		} else {
-			m_staticObjects[i] = new Dirt(x, y);
-		}
+	switch (kind) {
+	case K_DIRT:	obj = m_dirt.create(x, y); break;
+	case K_WALL:	obj = m_walls.create(x, y); break;
+	case K_FLORA:	obj = m_flora.create(Point(x, y)); break;
+	case K_GRASS:	obj = m_grass.create(Point(x, y)); break;
+	default: break;
+	}
+
+	m_staticObjects[i] = obj;
+	m_staticKinds[i] = (unsigned char)kind;
 
+	if (obj) {
 		MobilityModel *m = m_grid.list();
-		m[i] = m_staticObjects[i]->mobilityModel();
+		m[i] = obj->mobilityModel();
 	}
 }
 
+std::vector<Tile> Map::staticTiles() const
+{
+	std::vector<Tile> tiles(m_staticObjects.size());
+
+	for (size_t i = 0; i < m_staticObjects.size(); i++) {
+		if (m_staticObjects[i]) {
+			tiles[i] = m_staticObjects[i]->tile();
+		}
+	}
+
+	return tiles;
+}
+
+void Map::restore(const std::vector<unsigned char>& kinds, const std::vector<Tile>& tiles)
+{
+	if (kinds.size() != m_staticKinds.size()) return;
+	if (tiles.size() != m_staticKinds.size()) return;
+
+	for (int y = 0; y < m_height; y++) {
+		for (int x = 0; x < m_width; x++) {
+			int i = x + y * m_width;
+
+			setStatic(x, y, (StaticKind)kinds[i]);
+
+			if (m_staticObjects[i]) {
+				m_staticObjects[i]->setTile(tiles[i]);
+			}
+		}
+	}
+}
+
+void Map::releaseStatic(int i)
+{
+	Object* obj = m_staticObjects[i];
+
+	switch (m_staticKinds[i]) {
+	case K_DIRT:	m_dirt.destroy(static_cast<Dirt*>(obj)); break;
+	case K_WALL:	m_walls.destroy(static_cast<Wall*>(obj)); break;
+	case K_FLORA:	m_flora.destroy(static_cast<FloraWall*>(obj)); break;
+	case K_GRASS:	m_grass.destroy(static_cast<Grass*>(obj)); break;
+	default: break;
+	}
+
+	m_staticObjects[i] = static_cast<Object*>(0);
+	m_staticKinds[i] = K_NONE;
+}
+
 void Map::overgrow(int x, int y, int around)
 {
     int i = x + y * m_width;
     bool placed = false;
 
-    if (inbounds(x, y) && i < m_staticObjects.size()) {
-        Object *obj = m_staticObjects[i];
-
-        if (dynamic_cast<Wall*>(obj)) {
-            m_staticObjects[i] = new FloraWall(Point(x, y));
+    if (inbounds(x, y)) {
+        if (m_staticKinds[i] == K_WALL) {
+            setStatic(x, y, K_FLORA);
             placed = true;
-            delete obj;
         }
-        else if (dynamic_cast<Dirt*>(obj)) {
-            m_staticObjects[i] = new Grass(Point(x, y));
+        else if (m_staticKinds[i] == K_DIRT) {
+            setStatic(x, y, K_GRASS);
             placed = true;
-            delete obj;
         }
 
         if (!placed) {
             return;
         }
 
-        MobilityModel *m = m_grid.list();
-        m[i] = m_staticObjects[i]->mobilityModel();
-
         if (around > 1) {
             around--;
 
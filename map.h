@@ -8,6 +8,8 @@
 #include "lighting.h"
 #include "object.h"
 
+#include "sys/arena.h"
+
 #include <string>
 #include <vector>
 #include <stdio.h>
@@ -46,8 +48,10 @@ public:
 class Torch : public NamedObject
 {
 public:
-	Torch(int x, int y, int level, int rad);
+	Torch(int x, int y, float level, int rad);
 	~Torch();
+
+	ObjectKind kind() const { return O_TORCH; }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -60,6 +64,10 @@ public:
 class Map
 {
 public:
+	// the concrete type of every static object, so it can be handed back to
+	// the right pool (and saved)
+	enum StaticKind { K_NONE = 0, K_DIRT, K_WALL, K_FLORA, K_GRASS };
+
 	Map(int w, int h);
 	~Map();
 
@@ -80,6 +88,13 @@ public:
 
 	const MobilityList* staticCopy();
 
+	// the StaticKind and tile of every cell, and rebuilds the map from them.
+	// Static objects pick random colors when made, so the saved tiles are
+	// put back on them
+	const std::vector<unsigned char>& staticKinds() const { return m_staticKinds; }
+	std::vector<Tile> staticTiles() const;
+	void restore(const std::vector<unsigned char>& kinds, const std::vector<Tile>& tiles);
+
 	// finds a random free point on the map at least d cells away from any
 	// wall - Point(-1, -1) is returned if no cell can be found that meets
 	// the given criteria
@@ -163,6 +178,10 @@ protected:
 
 	void placeRandomTorches(ObjectMap& dynamObj);
 
+	// replaces the static object at (x, y) with a new one of the given kind
+	void setStatic(int x, int y, StaticKind kind);
+	void releaseStatic(int i);
+
 protected:
 	int m_width;
 	int m_height;
@@ -191,6 +210,15 @@ protected:
 
 	MobilityList m_grid;
 	ObjectMap m_staticObjects;
+	std::vector<unsigned char> m_staticKinds;
+
+	// static objects are pooled per type out of one arena, which is released
+	// all at once with the map
+	sys::arena m_arena;
+	sys::pool<Dirt> m_dirt;
+	sys::pool<Wall> m_walls;
+	sys::pool<FloraWall> m_flora;
+	sys::pool<Grass> m_grass;
 
 	// a weight map for the distance from any wall
 	WeightMap m_distMap;
@@ -1,11 +1,13 @@
 #include "object.h"
+#include "context.h"
 #include "rnd.h"
 
 Object::Object(const Point& pos, int icon, const gtti::Color& color) :
 	m_position(pos),
 	m_icon(icon),
 	m_fgColor(color),
-	m_light(NULL)
+	m_light(NULL),
+	m_flavor("")
 {
 }
 
@@ -14,7 +16,8 @@ Object::Object(int x, int y, int icon, const gtti::Color& color) :
 	m_position(x, y),
 	m_icon(icon),
 	m_fgColor(color),
-	m_light(NULL)
+	m_light(NULL),
+	m_flavor("")
 {
 }
 
@@ -29,6 +32,15 @@ Point Object::coords() const
 	return m_position;
 }
 
+void Object::moveTo(const Point& p)
+{
+	m_position = p;
+
+	if (m_light) {
+		m_light->position = p;
+	}
+}
+
 Tile Object::tile() const
 {
 	Tile t(m_fgColor, m_icon);
@@ -37,6 +49,13 @@ Tile Object::tile() const
 	return t;
 }
 
+void Object::setTile(const Tile& t)
+{
+	m_icon = t.icon;
+	m_fgColor = t.fgColor;
+	m_bgColor = t.bgColor;
+}
+
 LightingModel Object::lightingModel() const
 {
 	return m_lightingModel;
@@ -61,7 +80,7 @@ MagicTree::MagicTree(const Point& p) : Object(p, 5, gtti::Color::lerp(gtti::Colo
 	m_lightingModel.ambientColor = gtti::Color(96, 96, 96);
 	m_lightingModel.flags |= L_ALWAYS_LIT;
 
-	m_flavor = std::string("a large tree glowing with magical energy");
+	m_flavor = "a large tree glowing with magical energy";
 }
 
 MagicTree::~MagicTree()
@@ -84,10 +103,70 @@ MagicShroom::MagicShroom(const Point& p) : NamedObject("mushroom", p, 140, gtti:
 	m_lightingModel.ambientColor = gtti::Color(96, 96, 96);
 	m_lightingModel.flags |= L_TRANSPARENT;
 
-	m_flavor = std::string("a strange looking fungus, possibly with magical properties");
+	m_flavor = "a strange looking fungus, possibly with magical properties";
 }
 
 MagicShroom::~MagicShroom()
 {
 	delete m_light;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+Wisp::Wisp(const Point& p) : Object(p, 15, gtti::Color::lerp(gtti::Color::sky, gtti::Color::white, Rnd::rndn())),
+	m_next(p),
+	m_seed((uint32_t)Rnd::between(1, 0x7fffffff))
+{
+	m_light = new Light(m_position.x(), m_position.y(),
+						Rnd::betweenf(0.6f, 0.9f), 3, m_fgColor);
+
+	m_mobilityModel.flags |= (M_WALKABLE | M_JUMPABLE | M_REACHABLE);
+
+	m_lightingModel.ambientColor = gtti::Color(96, 96, 96);
+	m_lightingModel.flags |= (L_TRANSPARENT | L_ALWAYS_LIT);
+
+	m_flavor = "a flickering wisp of light";
+}
+
+Wisp::~Wisp()
+{
+	delete m_light;
+}
+
+void Wisp::placed(Context* ctx, const EntityHandle& h)
+{
+	m_handle = h;
+	ctx->scheduler()->add(this);
+}
+
+void Wisp::think(const RenderPlanes* world)
+{
+	// xorshift
+	m_seed ^= m_seed << 13;
+	m_seed ^= m_seed >> 17;
+	m_seed ^= m_seed << 5;
+
+	m_next = m_position;
+
+	const MobilityList* mobility = world->mobility();
+
+	for (int i = 0; i < NNEIGHBORS; i++) {
+		const DN& d = NEIGHBORS[(m_seed + i) % NNEIGHBORS];
+		Point p(m_position.x() + d.dx, m_position.y() + d.dy);
+		const MobilityModel* m = mobility->get(p);
+
+		if ((m) && (m->flags & M_WALKABLE)) {
+			m_next = p;
+			break;
+		}
+	}
+}
+
+int Wisp::act(Context* ctx)
+{
+	if (!(m_next == m_position)) {
+		ctx->move(m_handle, m_next);
+	}
+
+	return sACTION_COST;
+}
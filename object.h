@@ -5,6 +5,20 @@
 
 #include "common.h"
 #include "lighting.h"
+#include "entity.h"
+#include "scheduler.h"
+
+#include <stdint.h>
+
+// concrete object types which can be recreated from a save
+enum ObjectKind
+{
+	O_NONE = 0,
+	O_MAGIC_TREE,
+	O_MAGIC_SHROOM,
+	O_TORCH,
+	O_WISP,
+};
 
 class Object
 {
@@ -17,14 +31,29 @@ public:
 	virtual void interact() {}
 	virtual std::string flavor() { return m_flavor; }
 
+	virtual ObjectKind kind() const { return O_NONE; }
+
+	// called once ctx has placed the object, h being its handle there
+	virtual void placed(Context* ctx, const EntityHandle& h) {}
+
 public:
 
 	virtual Point coords() const;
 	virtual Tile tile() const;
 
+	// gives the object the look it had when saved
+	void setTile(const Tile& t);
+
+	// moves the object (and its light).  An object in a context is moved
+	// with Context::move() instead
+	void moveTo(const Point& p);
+
 	virtual LightingModel lightingModel() const;
 	virtual MobilityModel mobilityModel() const;
 
+	// NULL if the object does not give off light
+	const Light* light() const { return m_light; }
+
 protected:
 	// elementary properties
 	Point m_position;
@@ -43,7 +72,8 @@ protected:
 	// object light (can be NULL if the object does not give off light)
 	Light* m_light;
 
-	std::string m_flavor;
+	// flavor text is always a string literal, so objects carry no heap string
+	const char* m_flavor;
 
 private:
 	// object id (TODO??)
@@ -72,6 +102,8 @@ class MagicTree : public Object
 public:
 	MagicTree(const Point& p);
 	~MagicTree();
+
+	ObjectKind kind() const { return O_MAGIC_TREE; }
 };
 
 class MagicShroom : public NamedObject
@@ -79,4 +111,33 @@ class MagicShroom : public NamedObject
 public:
 	MagicShroom(const Point& p);
 	~MagicShroom();
+
+	ObjectKind kind() const { return O_MAGIC_SHROOM; }
+};
+
+// A will-o'-the-wisp drifting about.  It picks a walkable neighbouring cell
+// while thinking and moves there when it acts
+class Wisp : public Object, public Actor
+{
+public:
+	Wisp(const Point& p);
+	~Wisp();
+
+	ObjectKind kind() const { return O_WISP; }
+
+	// starts taking turns in ctx
+	void placed(Context* ctx, const EntityHandle& h);
+
+	void think(const RenderPlanes* world);
+	int act(Context* ctx);
+
+	int speed() const { return sNORMAL_SPEED / 2; }
+
+protected:
+
+	EntityHandle m_handle;
+	Point m_next;
+
+	// think() may run on any thread, so the wisp has its own generator
+	uint32_t m_seed;
 };
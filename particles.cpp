@@ -0,0 +1,433 @@
+#include "particles.h"
+#include "common.h"
+#include "rnd.h"
+
+#include "sys/memstats.h"
+
+#include <algorithm>
+
+namespace {
+
+	// the lifetime of each type when spawn() is given 0
+	const int sLIFETIME[P_TYPES] = {
+		FPS,		// P_FLAME
+		20 * 20,	// P_ASH - 20 steps, one every 20 ticks
+		FPS * 10,	// P_RAIN - usually falls out of bounds first
+		FPS * 60	// P_SNOW
+	};
+
+	// the glyph of each type, 0 only colors the background
+	const unsigned char sICON[P_TYPES] = {
+		0,			// P_FLAME
+		249,		// P_ASH
+		'\'',		// P_RAIN
+		'*'			// P_SNOW
+	};
+
+	// the curve each type starts on
+	const unsigned char sCURVE[P_TYPES] = { 0, 2, 3, 4 };	// C_FLAME_BURST, C_ASH, C_RAIN, C_SNOW
+
+	// flames fly out for this many ticks, then stay put
+	const int sFLAME_EXTENT = 8;
+	const float sFLAME_BURST = 0.25f;
+
+	const int sASH_STEP = 20;
+
+	// cells per tick
+	const float sRAIN_SPEED = 1.0f;
+	const float sSNOW_SPEED = 0.15f;
+	const float sSNOW_SWAY = 0.3f;
+
+	// bytes per particle in a pool
+	const size_t sPARTICLE = 6 * sizeof(float) + 2 * sizeof(int) + 2 * sizeof(unsigned char);
+
+	inline unsigned char toShade(float t)
+	{
+		return (unsigned char)(std::min(1.0f, std::max(0.0f, t)) * 255.0f);
+	}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ParticleSystem::Pool::resize(int capacity)
+{
+	x.resize(capacity);
+	y.resize(capacity);
+	vx.resize(capacity);
+	vy.resize(capacity);
+	fx.resize(capacity);
+	fy.resize(capacity);
+	age.resize(capacity);
+	life.resize(capacity);
+	curve.resize(capacity);
+	shade.resize(capacity);
+}
+
+void ParticleSystem::Pool::remove(int i)
+{
+	int last = --count;
+
+	if (i == last) return;
+
+	x[i] = x[last];
+	y[i] = y[last];
+	vx[i] = vx[last];
+	vy[i] = vy[last];
+	fx[i] = fx[last];
+	fy[i] = fy[last];
+	age[i] = age[last];
+	life[i] = life[last];
+	curve[i] = curve[last];
+	shade[i] = shade[last];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ParticleSystem::ParticleSystem(int capacity) :
+	m_capacity(capacity), m_seed(0x9e3779b9u),
+	m_windX(0.0f), m_windY(0.0f),
+	m_width(0), m_height(0)
+{
+	for (int t = 0; t < P_TYPES; t++) {
+		m_pools[t].resize(capacity);
+	}
+
+	m_scratch.resize(capacity);
+
+	sys::mem_track(sys::MEM_PARTICLES, P_TYPES * capacity * sPARTICLE + capacity * sizeof(float));
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	sys::mem_untrack(sys::MEM_PARTICLES, P_TYPES * m_capacity * sPARTICLE + m_capacity * sizeof(float));
+}
+
+const gtti::Gradient& ParticleSystem::curve(int c)
+{
+	// baked once, looked up by every particle
+	static const gtti::Gradient curves[C_CURVES] = {
+		gtti::Gradient(gtti::Color::yellow, gtti::Color(255, 255, 127)).bake(),
+		gtti::Gradient(gtti::Color::yellow, gtti::Color(63, 15, 0)).bake(),
+		gtti::Gradient(gtti::Color(95, 95, 95), gtti::Color(255, 159, 63)).bake(),
+		gtti::Gradient(gtti::Color(131, 165, 255), gtti::Color(88, 110, 170)).bake(),
+		gtti::Gradient(gtti::Color::white, gtti::Color(190, 200, 220)).bake()
+	};
+
+	return curves[c];
+}
+
+bool ParticleSystem::spawn(ParticleType type, const PointF& pos, const PointF& force, int lifetime)
+{
+	Pool& p = m_pools[type];
+
+	if (p.count >= m_capacity) return false;
+
+	int i = p.count++;
+
+	p.x[i] = pos.x();
+	p.y[i] = pos.y();
+	p.vx[i] = 0.0f;
+	p.vy[i] = 0.0f;
+	p.fx[i] = force.x();
+	p.fy[i] = force.y();
+	p.age[i] = 0;
+	p.life[i] = ((lifetime > 0) ? lifetime : sLIFETIME[type]);
+	p.curve[i] = sCURVE[type];
+
+	switch (type) {
+	case P_ASH:		p.shade[i] = 255; break;
+	case P_RAIN:
+	case P_SNOW:	p.shade[i] = toShade(jitter()); break;	// no two drops alike
+	default:		p.shade[i] = 0; break;
+	}
+
+	return true;
+}
+
+void ParticleSystem::addForce(ParticleType type, const PointF& force)
+{
+	Pool& p = m_pools[type];
+	const float ax = force.x(), ay = force.y();
+
+	for (int i = 0; i < p.count; i++) {
+		p.fx[i] += ax;
+		p.fy[i] += ay;
+	}
+}
+
+void ParticleSystem::clear()
+{
+	for (int t = 0; t < P_TYPES; t++) {
+		m_pools[t].count = 0;
+	}
+}
+
+int ParticleSystem::count() const
+{
+	int n = 0;
+
+	for (int t = 0; t < P_TYPES; t++) {
+		n += m_pools[t].count;
+	}
+
+	return n;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ParticleSystem::integrate(Pool& p, const float* moving)
+{
+	const int n = p.count;
+
+	float* x = p.x.data();
+	float* y = p.y.data();
+	float* vx = p.vx.data();
+	float* vy = p.vy.data();
+	float* fx = p.fx.data();
+	float* fy = p.fy.data();
+
+	// mass = 1, delta time = 1.  moving is 1 or 0 per particle, so the
+	// loop has no branches
+	for (int i = 0; i < n; i++) {
+		vx[i] += fx[i];
+		vy[i] += fy[i];
+		x[i] += vx[i] * moving[i];
+		y[i] += vy[i] * moving[i];
+		fx[i] = 0.0f;
+		fy[i] = 0.0f;
+	}
+}
+
+void ParticleSystem::age(Pool& p)
+{
+	const int n = p.count;
+	int* a = p.age.data();
+
+	for (int i = 0; i < n; i++) {
+		a[i]++;
+	}
+}
+
+void ParticleSystem::reap(Pool& p)
+{
+	const bool bounded = ((m_width > 0) && (m_height > 0));
+	const float left = (float)-m_width, right = (float)(2 * m_width);
+	const float top = (float)-m_height, bottom = (float)m_height;
+
+	int i = 0;
+
+	while (i < p.count) {
+		bool out = (bounded && ((p.x[i] < left) || (p.x[i] >= right) || (p.y[i] < top) || (p.y[i] >= bottom)));
+
+		if (out || (p.age[i] > p.life[i])) {
+			// the last particle takes its place, look at i again
+			p.remove(i);
+		} else {
+			i++;
+		}
+	}
+}
+
+void ParticleSystem::updateFlame(Pool& p)
+{
+	const int n = p.count;
+	float* moving = m_scratch.data();
+
+	for (int i = 0; i < n; i++) {
+		moving[i] = ((p.age[i] < sFLAME_EXTENT) ? 1.0f : 0.0f);
+	}
+
+	integrate(p, moving);
+
+	// burning down, flickering by up to a quarter either way
+	for (int i = 0; i < n; i++) {
+		float life = (float)p.age[i] / (float)p.life[i];
+		float var = sFLAME_BURST * (1.0f - 2.0f * jitter());
+		bool burst = (p.age[i] < sFLAME_EXTENT);
+
+		p.curve[i] = (burst ? C_FLAME_BURST : C_FLAME);
+		p.shade[i] = toShade(burst ? (life / sFLAME_BURST + var) : (life + var));
+	}
+
+	age(p);
+}
+
+void ParticleSystem::updateAsh(Pool& p)
+{
+	const int n = p.count;
+	float* moving = m_scratch.data();
+
+	// brownian motion, a step every sASH_STEP ticks
+	for (int i = 0; i < n; i++) {
+		bool step = ((p.age[i] % sASH_STEP) == sASH_STEP - 1);
+
+		moving[i] = 1.0f;
+		p.vx[i] = 0.0f;
+		p.vy[i] = 0.0f;
+
+		if (step) {
+			p.fx[i] += (float)Rnd::rndg() + m_windX * sASH_STEP;
+			p.fy[i] += (float)Rnd::rndg() + m_windY * sASH_STEP;
+		}
+	}
+
+	integrate(p, moving);
+
+	for (int i = 0; i < n; i++) {
+		p.shade[i] = toShade(1.0f - (float)p.age[i] / (float)p.life[i]);
+	}
+
+	age(p);
+}
+
+void ParticleSystem::updateRain(Pool& p)
+{
+	const int n = p.count;
+	float* moving = m_scratch.data();
+
+	const PointF v = drift(P_RAIN);
+	const float vx = v.x();
+	const float vy = v.y();
+
+	// every drop falls at the same speed, forces only nudge it for a tick
+	for (int i = 0; i < n; i++) {
+		moving[i] = 1.0f;
+		p.vx[i] = vx;
+		p.vy[i] = vy;
+	}
+
+	integrate(p, moving);
+	age(p);
+}
+
+void ParticleSystem::updateSnow(Pool& p)
+{
+	const int n = p.count;
+	float* moving = m_scratch.data();
+
+	const PointF v = drift(P_SNOW);
+	const float vx = v.x();
+	const float vy = v.y();
+
+	for (int i = 0; i < n; i++) {
+		moving[i] = 1.0f;
+		p.vx[i] = vx + sSNOW_SWAY * (jitter() - 0.5f);
+		p.vy[i] = vy;
+	}
+
+	integrate(p, moving);
+	age(p);
+}
+
+PointF ParticleSystem::drift(ParticleType type) const
+{
+	switch (type) {
+	case P_RAIN:	return PointF(m_windX, sRAIN_SPEED + m_windY);
+	case P_SNOW:	return PointF(m_windX * 0.5f, sSNOW_SPEED + m_windY * 0.5f);
+	case P_ASH:		return PointF(m_windX, m_windY);
+	default:		return PointF(0.0f, 0.0f);
+	}
+}
+
+unsigned char ParticleSystem::icon(int type) const
+{
+	// rain slants with the wind
+	if (type == P_RAIN) {
+		if (m_windX > 0.3f) return '\\';
+		if (m_windX < -0.3f) return '/';
+	}
+
+	return sICON[type];
+}
+
+void ParticleSystem::update()
+{
+	updateFlame(m_pools[P_FLAME]);
+	updateAsh(m_pools[P_ASH]);
+	updateRain(m_pools[P_RAIN]);
+	updateSnow(m_pools[P_SNOW]);
+
+	for (int t = 0; t < P_TYPES; t++) {
+		reap(m_pools[t]);
+	}
+}
+
+void ParticleSystem::render(Console* layer)
+{
+	static const Icon blank;
+
+	const int w = layer->width();
+	const int h = layer->height();
+
+	for (size_t i = 0; i < m_drawn.size(); i++) {
+		int x = m_drawn[i] % w;
+		int y = m_drawn[i] / w;
+
+		if (y >= h) continue;
+
+		layer->setChar(x, y, blank._val);
+		layer->setCharForeground(x, y, blank._fg);
+		layer->setCharBackground(x, y, blank._bg);
+	}
+
+	m_drawn.clear();
+
+	for (int t = 0; t < P_TYPES; t++) {
+		const Pool& p = m_pools[t];
+		const unsigned char g = icon(t);
+
+		for (int i = 0; i < p.count; i++) {
+			int x = (int)p.x[i];
+			int y = (int)p.y[i];
+
+			if ((x < 0) || (y < 0) || (x >= w) || (y >= h)) continue;
+
+			::Color c = curve(p.curve[i]).getColor((float)p.shade[i] / 255.0f).toColor();
+
+			if (g == 0) {
+				layer->setCharBackground(x, y, c);
+			} else {
+				layer->setChar(x, y, g);
+				layer->setCharForeground(x, y, c);
+			}
+
+			m_drawn.push_back(x + y * w);
+		}
+	}
+}
+
+void ParticleSystem::render(FilterBuffer& buf)
+{
+	const int w = buf.width;
+	const int h = buf.height;
+
+	for (int t = 0; t < P_TYPES; t++) {
+		const Pool& p = m_pools[t];
+		const unsigned char g = icon(t);
+
+		// the glyph (or background) of the cell, opaque
+		unsigned char* out[4];
+
+		for (int c = 0; c < FilterBuffer::CHANNELS; c++) {
+			out[c] = ((g == 0) ? buf.bg[c].data() : buf.fg[c].data());
+		}
+
+		for (int i = 0; i < p.count; i++) {
+			int x = (int)p.x[i];
+			int y = (int)p.y[i];
+
+			if ((x < 0) || (y < 0) || (x >= w) || (y >= h)) continue;
+
+			int j = x + y * w;
+			gtti::Color c = curve(p.curve[i]).getColor((float)p.shade[i] / 255.0f);
+
+			if (g != 0) buf.glyph[j] = g;
+
+			out[FilterBuffer::R][j] = (unsigned char)c.r();
+			out[FilterBuffer::G][j] = (unsigned char)c.g();
+			out[FilterBuffer::B][j] = (unsigned char)c.b();
+			out[FilterBuffer::A][j] = 255;
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "geometry.h"
+#include "color.h"
+#include "TileEngine.h"
+
+#include <vector>
+
+enum ParticleType
+{
+	P_FLAME = 0,	// bursts out, then burns down from yellow to embers
+	P_ASH,			// drifts about at random, cooling from orange to grey
+	P_RAIN,			// falls fast, blown by the wind
+	P_SNOW,			// falls slowly, swaying
+
+	P_TYPES
+};
+
+// Every particle lives in a ParticleSystem, in a pool for its type which
+// keeps each property in its own array.  A tick runs one integrate and one
+// age kernel per type over those arrays - no allocation, no virtual calls -
+// and dead particles are swapped with the last live one, so the arrays stay
+// dense and their slots are reused by the next spawn.  render() writes every
+// particle into a console layer in one pass.
+//
+//		ParticleSystem ps(8192);
+//		ps.spawn(P_FLAME, PointF(x, y), PointF(0.3f, 0.1f));
+//		...
+//		ps.update();
+//		ps.render(layer);
+//
+class ParticleSystem
+{
+public:
+	// room for capacity particles of each type
+	ParticleSystem(int capacity);
+	~ParticleSystem();
+
+	// adds a particle with force applied on its first tick, living lifetime
+	// ticks (0 for the default of its type).  False if its pool is full
+	bool spawn(ParticleType type, const PointF& pos, const PointF& force = PointF(0.0f, 0.0f), int lifetime = 0);
+
+	// pushes every particle of type on the next tick
+	void addForce(ParticleType type, const PointF& force);
+
+	// carries rain, snow and ash along (in cells per tick)
+	void setWind(const PointF& wind) { m_windX = wind.x(); m_windY = wind.y(); }
+
+	// how fast particles of type move when nothing pushes them
+	PointF drift(ParticleType type) const;
+
+	// particles leaving a w x h area (give or take its size to the sides,
+	// where wind blown particles come from) die.  0 x 0 is no bounds
+	void setBounds(int w, int h) { m_width = w; m_height = h; }
+
+	// moves and ages every particle by one tick
+	void update();
+
+	// draws every particle into layer, erasing what the last render drew
+	void render(Console* layer);
+	// draws every particle over a frame (for filters)
+	void render(FilterBuffer& buf);
+
+	void clear();
+
+	int count() const;
+	int count(ParticleType type) const { return m_pools[type].count; }
+	int capacity() const { return m_capacity; }
+
+protected:
+
+	// the color curves particles are shaded along
+	enum Curve
+	{
+		C_FLAME_BURST = 0,
+		C_FLAME,
+		C_ASH,
+		C_RAIN,
+		C_SNOW,
+
+		C_CURVES
+	};
+
+	static const gtti::Gradient& curve(int c);
+
+	struct Pool
+	{
+		int count;
+
+		std::vector<float> x, y;
+		std::vector<float> vx, vy;
+		std::vector<float> fx, fy;		// applied once, on the next tick
+		std::vector<int> age, life;
+		std::vector<unsigned char> curve;
+		std::vector<unsigned char> shade;	// where on the curve, 0-255
+
+		Pool() : count(0) {}
+
+		void resize(int capacity);
+		void remove(int i);
+	};
+
+	// kernels shared by every type
+	static void integrate(Pool& p, const float* moving);
+	static void age(Pool& p);
+	void reap(Pool& p);
+
+	// per type
+	void updateFlame(Pool& p);
+	void updateAsh(Pool& p);
+	void updateRain(Pool& p);
+	void updateSnow(Pool& p);
+
+	// the glyph particles of type are drawn with
+	unsigned char icon(int type) const;
+
+	// a cheap random number in [0,1) for per particle jitter
+	inline float jitter()
+	{
+		m_seed = m_seed * 1664525u + 1013904223u;
+		return (float)(m_seed >> 8) / 16777216.0f;
+	}
+
+	Pool m_pools[P_TYPES];
+	int m_capacity;
+	unsigned int m_seed;
+
+	float m_windX, m_windY;
+	int m_width, m_height;
+
+	std::vector<float> m_scratch;
+	std::vector<int> m_drawn;		// cells written by the last render
+};
@@ -17,7 +17,7 @@ Pathfinder::~Pathfinder()
 {
 }
 
-void Pathfinder::dijkstra(PVector& path, TheGrid *grid, const Point& s, const Point& g)
+void Pathfinder::dijkstra(PVector& path, const MobilityList *grid, const Point& s, const Point& g)
 {
 	PriorityQueue frontier;
 	PriorityQueue::ParentMap parents;
@@ -47,7 +47,7 @@ void Pathfinder::dijkstra(PVector& path, TheGrid *grid, const Point& s, const Po
 	frontier.put(s, 0.0f);
 
 	// end tile not walkable, return
-	if (!(grid->get(g)->render->mobility.flags & M_WALKABLE)) return;
+	if (!(grid->get(g)->flags & M_WALKABLE)) return;
 
 	while (!frontier.empty()) {
 		cur = frontier.get();
@@ -64,7 +64,7 @@ void Pathfinder::dijkstra(PVector& path, TheGrid *grid, const Point& s, const Po
 
 			float cost = costs[cur] + fake_costs[i];
 
-			if ((grid->inbounds(Point(n.x, n.y))) && (grid->get(g)->render->mobility.flags & M_WALKABLE)) {
+			if ((grid->inbounds(Point(n.x, n.y))) && (grid->get(g)->flags & M_WALKABLE)) {
 				bool visited = (costs.count(n) > 0);
 
 				if ((!visited) || (cost < costs[n])) {
@@ -112,10 +112,10 @@ public:
 	Pathfinder();
 	~Pathfinder();
 
-	typedef void (*search_func)(PVector&, TheGrid*, const Point&, const Point&);
+	typedef void (*search_func)(PVector&, const MobilityList*, const Point&, const Point&);
 
-	static void dijkstra(PVector& path, TheGrid *grid, const Point& s, const Point& g);
-	static void weights(WeightMap* map, TheGrid *grid);
+	static void dijkstra(PVector& path, const MobilityList *grid, const Point& s, const Point& g);
+	static void weights(WeightMap* map, const MobilityList *grid);
 };
 
 
@@ -3,21 +3,7 @@
 
 void Player::apply_visible(void *map, int x, int y, int dx, int dy, void *src)
 {
-	TheGrid* g = (TheGrid *)map;
-//	Player* p = (Player *)src;
-
-	if ((g) && (g->inbounds(x, y))) {
-		g->at(x, y)->render->discover.flags |= D_SEEN;
-
-        unsigned int lf = g->get(x, y)->render->lighting.flags;
-
-		if ((lf & L_LIT) || (lf & L_ALWAYS_LIT)) {
-			// discovered!
-			g->at(x, y)->render->discover.flags |= D_EXPLORED;
-		} else {
-			g->at(x, y)->render->discover.flags |= D_HIDDEN;
-		}
-	}
+	LightingEngine::apply_visible(map, x, y, dx, dy, src);
 }
 
 
@@ -28,6 +14,11 @@ Player::Player(int x, int y) :
 {
 	m_light = new Light(x, y, 1.15f, Rnd::between(14,18), gtti::Color(255, 255, 171));
 
+	// our vision is calculated in the same pass as our light
+	m_light->sight = sight;
+	m_light->vision = Player::apply_visible;
+	m_light->viewer = this;
+
 	fov_settings_init(&m_visionFOV);
 	fov_settings_set_opacity_test_function(&m_visionFOV, LightingEngine::opaque);
     fov_settings_set_apply_lighting_function(&m_visionFOV, Player::apply_visible);
@@ -38,14 +29,20 @@ Player::~Player()
 	delete m_light;
 }
 
-bool Player::move(int dx, int dy, const TheGrid* grid)
+void Player::teleport(const Point& p)
+{
+	m_position = p;
+	m_light->position = p;
+}
+
+bool Player::move(int dx, int dy, const RenderPlanes* grid)
 {
 	int x = m_position.x() + dx;
 	int y = m_position.y() + dy;
 
 	bool ii = grid->inbounds(x, y);
 
-	if ((ii) && (grid->get(x, y)->render->mobility.flags & M_WALKABLE)) {
+	if ((ii) && (grid->mobility()->get(x, y)->flags & M_WALKABLE)) {
 		m_position = Point(x, y);
 		m_light->position = Point(x, y);
 
@@ -81,6 +78,19 @@ bool Player::move(int dx, int dy, const TheGrid* grid)
 	return false;
 }
 
+#ifdef TORCH_FLICKER
+int Player::flicker()
+{
+	// only called once the delay is due
+	m_delay.skip();
+	m_delay.tick();
+
+	m_light->lightLevel = Rnd::betweenf(6.5f, 10.0f);
+
+	return m_delay.ticksLeft();
+}
+#endif
+
 Point Player::inFrontOf() const
 {
     int dx = 0, dy = 0;
@@ -101,7 +111,7 @@ Point Player::inFrontOf() const
     return Point(m_position.x() + dx, m_position.y() + dy);
 }
 
-void Player::update(TheGrid *grid)
+void Player::update(RenderPlanes *grid)
 {
 
 #if 0
@@ -115,13 +125,7 @@ void Player::update(TheGrid *grid)
 #endif
 		m_light->ray.enabled = false;
 
-#ifdef TORCH_FLICKER
-		m_delay.tick();
-
-		if (!m_delay.delay()) {
-			m_light->lightLevel = Rnd::between(6.5f, 10.0f);
-		}
-#endif
+		// the torch flickers on its own timer, see flicker()
 	}
 
 
@@ -139,6 +143,10 @@ void Player::update(TheGrid *grid)
 #else
 	{
 #endif
-		fov_circle(&m_visionFOV, grid, this, m_position.x(), m_position.y(), sight);
+		// the lighting pass already found what we can see if our light was
+		// fused with our vision, otherwise walk our own fov
+		if (!m_light->consumeVision()) {
+			fov_circle(&m_visionFOV, grid, this, m_position.x(), m_position.y(), sight);
+		}
 	}
 }
@@ -8,7 +8,6 @@
 #include "object.h"
 
 
-#include "effects.h"
 
 //#define TORCH_FLICKER
 
@@ -22,13 +21,21 @@ public:
 	Player(int x, int y);
 	~Player();
 
-	void update(TheGrid* grid);
+	void update(RenderPlanes* grid);
 
 	// returns true if the player actually can move (and does)
-	bool move(int dx, int dy, const TheGrid* grid);
+	bool move(int dx, int dy, const RenderPlanes* grid);
 
     Point inFrontOf() const;
 
+	// moves the player (and its light) to p, no questions asked
+	void teleport(const Point& p);
+
+#ifdef TORCH_FLICKER
+	// changes the light level, returning the ticks until the next change
+	int flicker();
+#endif
+
 	// player attributes (TODO)
 	int sight;
 	int hearing;
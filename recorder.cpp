@@ -0,0 +1,319 @@
+#include "recorder.h"
+
+#include "TileEngine.h"
+
+#include "sys/logger.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+namespace gtti {
+
+const char recording::sMAGIC[4] = { 'G', 'T', 'T', 'R' };
+const uint16_t recording::sVERSION = 1;
+
+namespace {
+
+    uint64_t now()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    FILE* openFile(const char *path, const char *mode)
+    {
+        FILE *fp = NULL;
+#ifdef __PLATFORM_WIN32__
+        fopen_s(&fp, path, mode);
+#else
+        fp = fopen(path, mode);
+#endif
+        return fp;
+    }
+
+    // XORs cur with prev, then replaces runs of zero bytes with (0, length)
+    void encode(const std::vector<unsigned char> &cur, const std::vector<unsigned char> &prev,
+                std::vector<unsigned char> &out)
+    {
+        unsigned int zeros = 0;
+
+        out.clear();
+
+        for (size_t i = 0; i < cur.size(); i++) {
+            unsigned char d = cur[i] ^ prev[i];
+
+            if (d == 0) {
+                if (++zeros == 255) {
+                    out.push_back(0);
+                    out.push_back(255);
+                    zeros = 0;
+                }
+                continue;
+            }
+
+            if (zeros) {
+                out.push_back(0);
+                out.push_back((unsigned char)zeros);
+                zeros = 0;
+            }
+
+            out.push_back(d);
+        }
+
+        if (zeros) {
+            out.push_back(0);
+            out.push_back((unsigned char)zeros);
+        }
+    }
+
+    // the inverse of encode, XORing into planes in place.  False if in does
+    // not cover planes exactly
+    bool decode(const std::vector<unsigned char> &in, std::vector<unsigned char> &planes)
+    {
+        size_t n = planes.size();
+        size_t o = 0;
+
+        for (size_t i = 0; i < in.size(); i++) {
+            if (in[i] == 0) {
+                if (++i == in.size()) return false;
+
+                o += in[i];
+                if (o > n) return false;
+            } else {
+                if (o == n) return false;
+
+                planes[o++] ^= in[i];
+            }
+        }
+
+        return (o == n);
+    }
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void recording::pack(const FilterBuffer &frame, std::vector<unsigned char> &planes)
+{
+    const size_t n = frame.size();
+
+    planes.resize(n * sPLANES);
+
+    unsigned char *p = planes.data();
+
+    std::copy(frame.glyph.begin(), frame.glyph.end(), p);
+    std::copy(frame.font.begin(), frame.font.end(), p + n);
+
+    for (int c = 0; c < FilterBuffer::CHANNELS; c++) {
+        std::copy(frame.fg[c].begin(), frame.fg[c].end(), p + (2 + c) * n);
+        std::copy(frame.bg[c].begin(), frame.bg[c].end(), p + (6 + c) * n);
+    }
+}
+
+void recording::unpack(const std::vector<unsigned char> &planes, FilterBuffer &frame)
+{
+    const size_t n = frame.size();
+    const unsigned char *p = planes.data();
+
+    std::copy(p, p + n, frame.glyph.begin());
+    std::copy(p + n, p + 2 * n, frame.font.begin());
+
+    for (int c = 0; c < FilterBuffer::CHANNELS; c++) {
+        std::copy(p + (2 + c) * n, p + (3 + c) * n, frame.fg[c].begin());
+        std::copy(p + (6 + c) * n, p + (7 + c) * n, frame.bg[c].begin());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+recorder::recorder() :
+    _fp(NULL), _last(0), _frames(0), _bytes(0)
+{
+}
+
+recorder::~recorder()
+{
+    close();
+}
+
+bool recorder::open(const char *file)
+{
+    close();
+
+    _fp = openFile(file, "wb");
+
+    if (!_fp) {
+        sys::logger::log("recorder: can not write %s", file);
+        return false;
+    }
+
+    bool ok = ((fwrite(recording::sMAGIC, sizeof(recording::sMAGIC), 1, _fp) == 1) &&
+               (fwrite(&recording::sVERSION, sizeof(recording::sVERSION), 1, _fp) == 1));
+
+    if (!ok) {
+        close();
+        return false;
+    }
+
+    _prev.clear();
+    _last = now();
+    _frames = 0;
+    _bytes = sizeof(recording::sMAGIC) + sizeof(recording::sVERSION);
+
+    return true;
+}
+
+void recorder::close()
+{
+    if (!_fp) return;
+
+    fclose(_fp);
+    _fp = NULL;
+
+    sys::logger::log("recorder: %llu frames in %llu bytes", _frames, _bytes);
+}
+
+void recorder::record(const FilterBuffer &frame)
+{
+    if (!_fp) return;
+
+    recording::pack(frame, _planes);
+
+    // nothing changed, the time goes to the next frame which does
+    if ((_frames > 0) && (_prev == _planes)) {
+        return;
+    }
+
+    // a new size starts from an empty frame
+    if (_prev.size() != _planes.size()) {
+        _prev.assign(_planes.size(), 0);
+    }
+
+    encode(_planes, _prev, _block);
+
+    uint64_t t = now();
+
+    recording::frame_header h;
+    h.ms = (uint32_t)(t - _last);
+    h.width = (uint16_t)frame.width;
+    h.height = (uint16_t)frame.height;
+    h.length = (uint32_t)_block.size();
+
+    _last = t;
+
+    bool ok = (fwrite(&h, sizeof(h), 1, _fp) == 1);
+    if (ok && h.length) ok = (fwrite(_block.data(), 1, h.length, _fp) == h.length);
+
+    if (!ok) {
+        sys::logger::log("recorder: write failed, stopping");
+        close();
+        return;
+    }
+
+    _prev.swap(_planes);
+    _frames++;
+    _bytes += sizeof(h) + h.length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+player::player() :
+    _fp(NULL), _start(0)
+{
+}
+
+player::~player()
+{
+    close();
+}
+
+bool player::open(const char *file)
+{
+    close();
+
+    _fp = openFile(file, "rb");
+
+    if (!_fp) {
+        sys::logger::log("player: can not read %s", file);
+        return false;
+    }
+
+    char magic[4];
+    uint16_t version = 0;
+
+    bool ok = ((fread(magic, sizeof(magic), 1, _fp) == 1) &&
+               (fread(&version, sizeof(version), 1, _fp) == 1) &&
+               (memcmp(magic, recording::sMAGIC, sizeof(magic)) == 0) &&
+               (version == recording::sVERSION));
+
+    if (!ok) {
+        sys::logger::log("player: %s is not a recording", file);
+        close();
+        return false;
+    }
+
+    _start = ftell(_fp);
+    _planes.clear();
+
+    return true;
+}
+
+void player::close()
+{
+    if (_fp) {
+        fclose(_fp);
+        _fp = NULL;
+    }
+}
+
+bool player::rewind()
+{
+    if (!_fp) return false;
+
+    _planes.clear();
+
+    return (fseek(_fp, _start, SEEK_SET) == 0);
+}
+
+bool player::next(FilterBuffer &frame, unsigned int &ms)
+{
+    if (!_fp) return false;
+
+    recording::frame_header h;
+
+    if (fread(&h, sizeof(h), 1, _fp) != 1) return false;
+
+    size_t cells = (size_t)h.width * h.height;
+    size_t n = cells * recording::sPLANES;
+
+    // encode never writes more than 2 bytes for each one it is given
+    if ((cells > recording::sMAX_CELLS) || (h.length > 2 * n)) {
+        sys::logger::log("player: damaged frame");
+        return false;
+    }
+
+    _block.resize(h.length);
+    if (h.length && (fread(_block.data(), 1, h.length, _fp) != h.length)) return false;
+
+    // a new size starts from an empty frame
+    if (_planes.size() != n) {
+        _planes.assign(n, 0);
+    }
+
+    if (!decode(_block, _planes)) {
+        sys::logger::log("player: damaged frame");
+        return false;
+    }
+
+    if ((frame.width != h.width) || (frame.height != h.height)) {
+        frame.resize(h.width, h.height);
+    }
+
+    recording::unpack(_planes, frame);
+    ms = h.ms;
+
+    return true;
+}
+
+} // namespace gtti
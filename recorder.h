@@ -0,0 +1,99 @@
+#ifndef __INCLUDE_RECORDER_H__
+#define __INCLUDE_RECORDER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+struct FilterBuffer;
+
+namespace gtti {
+
+// Recorded sessions are a sequence of composited frames.  Each frame is
+// stored as its planes XORed with the planes of the frame before, with runs
+// of zero bytes written as (0, length) - a frame where little changed takes
+// a few bytes.  A frame of a different size is stored against an empty one.
+// A frame identical to the one before is not stored at all, its time is
+// added to the next frame's ms.
+//
+// Font ids are stored as they are; a recording plays back correctly when
+// the player loads the same tilesets in the same order.
+struct recording
+{
+    static const char sMAGIC[4];
+    static const uint16_t sVERSION;
+
+    struct frame_header
+    {
+        uint32_t ms;        // since the frame before
+        uint16_t width;
+        uint16_t height;
+        uint32_t length;    // of the encoded planes
+    };
+
+    // the planes of a frame in file order: glyph, font, fg rgba, bg rgba
+    static const int sPLANES = 10;
+
+    // frames with more cells than this are taken to be damaged
+    static const uint32_t sMAX_CELLS = 1 << 20;
+
+    static void pack(const FilterBuffer &frame, std::vector<unsigned char> &planes);
+    static void unpack(const std::vector<unsigned char> &planes, FilterBuffer &frame);
+};
+
+// Writes frames to a file as they are drawn (see TileEngine::setRecorder)
+class recorder
+{
+public:
+    recorder();
+    ~recorder();
+
+    bool open(const char *file);
+    void close();
+    bool recording() const { return (_fp != NULL); }
+
+    void record(const FilterBuffer &frame);
+
+    unsigned long long frames() const { return _frames; }
+    unsigned long long bytes() const { return _bytes; }
+
+protected:
+    FILE *_fp;
+    uint64_t _last;     // ms, when the last frame was recorded
+
+    std::vector<unsigned char> _prev;
+    std::vector<unsigned char> _planes;
+    std::vector<unsigned char> _block;
+
+    unsigned long long _frames;
+    unsigned long long _bytes;
+};
+
+// Reads the frames of a recording back, one at a time
+class player
+{
+public:
+    player();
+    ~player();
+
+    bool open(const char *file);
+    void close();
+
+    // the next frame and the ms since the one before, false at the end of
+    // the recording (or if it is damaged)
+    bool next(FilterBuffer &frame, unsigned int &ms);
+
+    // back to the first frame
+    bool rewind();
+
+protected:
+    FILE *_fp;
+    long _start;        // offset of the first frame
+
+    std::vector<unsigned char> _planes;
+    std::vector<unsigned char> _block;
+};
+
+} // namespace gtti
+
+#endif
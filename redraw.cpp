@@ -0,0 +1,121 @@
+#include "redraw.h"
+
+#include "sys/logger.h"
+
+const int RedrawScheduler::sIDLE_MS = 50;
+
+RedrawScheduler::RedrawScheduler(int fps, int idleMs) :
+	m_budgetMs(1000.0f / (float)std::max(1, fps)),
+	m_idle(std::chrono::milliseconds(idleMs)),
+	m_dirty(true),
+	m_deadline(clock::time_point::max()),
+	m_drawing(false)
+{
+	m_stats.drawn = 0;
+	m_stats.skipped = 0;
+	m_stats.overBudget = 0;
+	m_stats.lastMs = 0.0f;
+	m_stats.averageMs = 0.0f;
+	m_stats.maxMs = 0.0f;
+}
+
+RedrawScheduler::~RedrawScheduler()
+{
+}
+
+void RedrawScheduler::invalidate()
+{
+	if (!m_dirty.exchange(true)) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_wake.notify_all();
+	}
+}
+
+void RedrawScheduler::wakeAt(const clock::time_point& t)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (t < m_deadline) {
+		m_deadline = t;
+		m_wake.notify_all();
+	}
+}
+
+void RedrawScheduler::wakeIn(int ms)
+{
+	wakeAt(clock::now() + std::chrono::milliseconds(ms));
+}
+
+bool RedrawScheduler::begin()
+{
+	clock::time_point now = clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_deadline <= now) {
+			m_deadline = clock::time_point::max();
+			m_dirty = true;
+		}
+	}
+
+	m_drawing = m_dirty.exchange(false);
+	m_start = now;
+
+	if (!m_drawing) {
+		m_stats.skipped++;
+	}
+
+	return m_drawing;
+}
+
+void RedrawScheduler::end()
+{
+	if (!m_drawing) return;
+
+	float ms = std::chrono::duration<float, std::milli>(clock::now() - m_start).count();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_stats.drawn++;
+	m_stats.lastMs = ms;
+	m_stats.maxMs = std::max(m_stats.maxMs, ms);
+	m_stats.averageMs = ((m_stats.drawn == 1) ? ms : (m_stats.averageMs * 0.9f + ms * 0.1f));
+
+	if (ms > m_budgetMs) {
+		m_stats.overBudget++;
+	}
+
+	m_drawing = false;
+}
+
+void RedrawScheduler::idle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	clock::time_point until = std::min(m_deadline, clock::now() + m_idle);
+
+	m_wake.wait_until(lock, until, [this]() {
+		return (m_dirty.load() || (m_deadline <= clock::now()));
+	});
+}
+
+RedrawScheduler::Stats RedrawScheduler::stats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_stats;
+}
+
+void RedrawScheduler::dump() const
+{
+	Stats s = stats();
+
+	sys::logger::log("-- frames --");
+	sys::logger::log("  drawn        %llu", s.drawn);
+	sys::logger::log("  skipped      %llu", s.skipped);
+	sys::logger::log("  over budget  %llu (%.2f ms)", s.overBudget, m_budgetMs);
+	sys::logger::log("  last         %.2f ms", s.lastMs);
+	sys::logger::log("  average      %.2f ms", s.averageMs);
+	sys::logger::log("  max          %.2f ms", s.maxMs);
+}
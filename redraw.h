@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+// Decides when the screen has to be drawn again.  Anything which changes
+// what is on screen either invalidates the frame (input, a finished turn)
+// or asks to be woken at a deadline (animations); things which change every
+// frame (active filters) invalidate it each time.  Frames nobody asked for
+// are skipped and the main loop sleeps until the next deadline instead.
+//
+//		while (running) {
+//			input();
+//			if (redraw.begin()) draw(); else present();
+//			redraw.end();
+//			redraw.idle();
+//		}
+//
+class RedrawScheduler
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	struct Stats
+	{
+		unsigned long long drawn;		// frames drawn from scratch
+		unsigned long long skipped;		// frames nothing asked for
+		unsigned long long overBudget;	// drawn frames slower than the budget
+		float lastMs;
+		float averageMs;				// moving average of drawn frames
+		float maxMs;
+	};
+
+	// fps sets the frame budget, idleMs is the longest the loop sleeps while
+	// nothing is due (input is only polled between sleeps)
+	RedrawScheduler(int fps = FPS, int idleMs = sIDLE_MS);
+	~RedrawScheduler();
+
+	// the next frame has to be drawn, safe from any thread
+	void invalidate();
+
+	// the frame has to be drawn again at (or after) t, safe from any thread
+	void wakeAt(const clock::time_point& t);
+	void wakeIn(int ms);
+
+	// starts a frame, true if it has to be drawn
+	bool begin();
+	// ends the frame started by begin()
+	void end();
+
+	// sleeps until the next frame is due, an invalidation or idleMs
+	void idle();
+
+	float budgetMs() const { return m_budgetMs; }
+	Stats stats() const;
+
+	// logs the stats
+	void dump() const;
+
+	static const int sIDLE_MS;
+
+protected:
+
+	float m_budgetMs;
+	clock::duration m_idle;
+
+	std::atomic<bool> m_dirty;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	clock::time_point m_deadline;		// time_point::max() if there is none
+
+	clock::time_point m_start;
+	bool m_drawing;
+
+	Stats m_stats;
+};
@@ -1,17 +1,27 @@
 #include "render.h"
 #include "engine.h"
 
+namespace {
+
+	void print(Console* c, int x, int y, const char* sz, const gtti::Color& fg)
+	{
+		for (; *sz && (x < c->width()); sz++, x++) {
+			c->setChar(x, y, (unsigned char)*sz);
+			c->setCharForeground(x, y, fg.toColor());
+		}
+	}
+
+}
+
 RenderThread::RenderThread(TileEngine *eng, Context* ctx) :
 	sys::thread(THREAD_JOINABLE),
-	m_context(ctx),
+	m_render(NULL),
     m_renderer(eng),
+	m_context(ctx),
 	m_mode(R_NORMAL),
-	m_done(false)
+	m_done(false),
+	m_showMemory(false)
 {
-	Size s = ctx->viewport()->viewport().size();
-
-	m_render = new RenderSettings(s.width(), s.height());
-
     m_listener->addListener(sys::EVENT_RENDER, ev_render);
 
 
@@ -25,14 +35,16 @@ RenderThread::RenderThread(TileEngine *eng, Context* ctx) :
     m_rootCanvas = new ui::canvas(eng->addLayer("ui", 0, 0, eng->mainConsole()->width(), eng->mainConsole()->height()));
     m_cursor = eng->addLayer("cursor", 0, 0, 1, 1);
 
+    m_memory = eng->addLayer("memory", 0, 0, 48, sys::MEM_TAGS + 2);
+    m_memory->setBackgroundColor(gtti::Color(0, 0, 0, 192));
+    m_memory->hide();
+
     printf("EE: setting up console %p\n", ctx->console());
 #endif
 }
 
 RenderThread::~RenderThread()
 {
-	delete m_render;
-
 	delete m_renderer;
     delete m_rootCanvas;
 
@@ -48,27 +60,27 @@ void RenderThread::ev_render(void *tag, const sys::token_id id)
 
 void RenderThread::render()
 {
-    if (m_context->trycopy(m_render, &m_playerPos, &m_playerTile)) {
-        return;
-    }
+    // always draw the latest complete turn, the update thread never waits
+    // on us and we never wait on it
+    const Snapshot* snap = m_context->snapshot();
 
-    //	m_renderer->clear();
+    if (snap) {
+        m_render = &snap->planes;
+        m_playerPos = snap->playerPos;
+        m_playerTile = snap->playerTile;
 
-    // render player's view
-	for (int x = 0; x < m_render->width(); x++) {
-		for (int y = 0; y < m_render->height(); y++) {
-			draw(x, y);
-//			m_render->at(x, y)->lighting.reset();
-//			m_render->at(x, y)->discover.reset();
-		}
-	}
+        //	m_renderer->clear();
 
-	// render player
-	int px = m_playerPos.x();
-	int py = m_playerPos.y();
+        // render player's view
+        drawViewport();
 
-	m_renderer->setChar(px, py, m_playerTile.icon);
-	m_renderer->setCharForeground(px, py, m_playerTile.fgColor.toColor());
+        // render player
+        int px = m_playerPos.x();
+        int py = m_playerPos.y();
+
+        m_renderer->setChar(px, py, m_playerTile.icon);
+        m_renderer->setCharForeground(px, py, m_playerTile.fgColor.toColor());
+    }
 
 	// blit the console
 //	TCODConsole::blit(m_renderer, 0, 0, 0, 0, TCODConsole::root, 0, HEADER_SPACE);
@@ -102,10 +114,19 @@ void RenderThread::render()
         m_cursor->hide();
     }
 
-    BeginDrawing();
-        ClearBackground(BLACK);
-        m_renderer->draw();
-    EndDrawing();
+    if (m_showMemory) {
+        drawMemory();
+
+        // the numbers change without anything else on screen doing so
+        Engine::redraw()->wakeIn(500);
+    }
+
+    m_renderer->frame(BLACK);
+}
+
+void RenderThread::present()
+{
+    m_renderer->repeat(BLACK);
 }
 
 void RenderThread::thread_func()
@@ -117,182 +138,73 @@ void RenderThread::thread_func()
 	}
 }
 
-void RenderThread::draw(int x, int y) const
+void RenderThread::drawViewport()
 {
+	m_shader.load(m_render);
+
 	switch (m_mode) {
 	default:
 	case R_NORMAL:
-		drawNormal(x, y);
+		m_shader.shadeNormal();
 		break;
 	case R_TRUECOLOR:
-		drawTruecolor(x, y);
-		break;
-	case R_STEALTH:
-		drawStealth(x, y);
+		m_shader.shadeTruecolor();
 		break;
 	case R_FULL:
-		drawFull(x, y);
+		m_shader.shadeFull();
 		break;
+	case R_STEALTH:
 	case R_DEBUG_DISCOVERY:
-		drawDebugDiscovery(x, y);
-		break;
 	case R_DEBUG_PATHING:
-		drawDebugPathing(x, y);
+		m_shader.shadeNone();
 		break;
 	}
-}
-
-void RenderThread::drawNormal(int x, int y) const
-{
-	static const float sAMBIENT_MAX = 0.75f;
-	static const float sAMBIENT_MIN = 0.35f;
 
-    gtti::Color fg = m_render->get(x, y)->tile.fgColor;
-    gtti::Color bg = m_render->get(x, y)->tile.bgColor;
-    gtti::Color dbg = bg, dfg = fg;	// dxg - saturated color (varies with ambient color)
-    gtti::Color fog = fg;				// fog-of-war color
+	const int w = m_shader.width();
 
-	float ac = m_render->get(x, y)->lighting.ambientColor.average();
+	for (int i = 0; i < m_shader.size(); i++) {
+		if (!m_shader.write[i]) continue;
 
-	// some ambient (dark, but visible) value - scaled by tile ambient light
-	float sat = std::max(sAMBIENT_MIN, std::min(sAMBIENT_MAX, ac / (float)255));
+		int x = i % w;
+		int y = i / w;
 
-	int icon = m_render->get(x, y)->tile.icon;
-
-#if 0
-	// if there is no background color, and either the the icon is a space (so the fg color
-	// doesnt matter) or there is no foreground color, then just return because there is nothing
-	// to draw.
-	if ((bg == gtti::Color::black) && ((icon == ' ') || (fg == gtti::Color::black))) return;
-#endif
-
-	// draw char
-	m_renderer->setChar(x, y, icon);
-
-	dfg.darken(sat);
-	dbg.darken(sat);
-	fog.darken(sat - sAMBIENT_MIN);
-
-    gtti::Color lc = m_render->get(x, y)->lighting.lightColor;
-	lc.smooth();
-
-	if (m_render->get(x, y)->discover.flags & D_SEEN) {
-		if (m_render->get(x, y)->lighting.flags & L_LIT) {
-#if 1
-			// if visible, draw at the given light level
-            gtti::Color lfg = gtti::Color::multiply(fg, lc);
-            gtti::Color lbg = gtti::Color::multiply(bg, lc);
-			lfg.clamp(dfg, gtti::Color::white);
-			lbg.clamp(dbg, gtti::Color::white);
-#else
-            gtti::Color lfg = gtti::Color::blend
-#endif
-
-			m_renderer->setCharForeground(x, y, lfg.toColor());
-			m_renderer->setCharBackground(x, y, lbg.toColor());
-		} else if (m_render->get(x, y)->discover.flags & D_EXPLORED) {
-			// explored, but in the dark
-			m_renderer->setCharForeground(x, y, dfg.toColor());
-			m_renderer->setCharBackground(x, y, dbg.toColor());
-		} else {
-			// seen it, but not explored
-			m_renderer->setCharForeground(x, y, gtti::Color::black.toColor());
-			m_renderer->setCharBackground(x, y, gtti::Color::black.toColor());
-		}
-
-		if ((m_render->get(x, y)->discover.flags & D_EXPLORED) &&
-			(m_render->get(x, y)->lighting.flags & L_ALWAYS_LIT)) {
-			m_renderer->setCharForeground(x, y, fg.toColor());
-		}
-	} else if (m_render->get(x, y)->discover.flags & D_EXPLORED) {
-		if ((m_render->get(x, y)->lighting.flags & L_TRANSPARENT) &&
-			(!(m_render->get(x, y)->lighting.flags & L_ALWAYS_LIT))) {
-			// if transparent, but not a full-if-visible token just color with
-			// a really dark fog of war
-			m_renderer->setCharForeground(x, y, fog.toColor());
-			m_renderer->setCharBackground(x, y, fog.toColor());
-		} else {
-			// otherwise, saturate
-			m_renderer->setCharForeground(x, y, dfg.toColor());
-			m_renderer->setCharBackground(x, y, dbg.toColor());
-		}
-
-//		m_renderer->setCharBackground(x, y, TCODColor::black);
-	} else {
-		// not seen, black
-		m_renderer->setCharForeground(x, y, gtti::Color::black.toColor());
-		m_renderer->setCharBackground(x, y, gtti::Color::black.toColor());
+		m_renderer->setChar(x, y, m_shader.glyph[i]);
+		m_renderer->setCharForeground(x, y, m_shader.fg(i));
+		m_renderer->setCharBackground(x, y, m_shader.bg(i));
 	}
 }
 
-void RenderThread::drawTruecolor(int x, int y) const
+void RenderThread::toggleMemory()
 {
-    gtti::Color fg = m_render->get(x, y)->tile.fgColor;
-    gtti::Color bg = m_render->get(x, y)->tile.bgColor;
+	m_showMemory = !m_showMemory;
 
-    gtti::Color lc = m_render->get(x, y)->lighting.lightColor;
-	lc.smooth();
-
-//	int llevel = (lc.r() + lc.b() + lc.g());
-
-	int icon = m_render->get(x, y)->tile.icon;
-
-	// if there is no background color, and either the the icon is a space (so the fg color
-	// doesnt matter) or there is no foreground color, then just return because there is nothing
-	// to draw.
-	if ((bg == gtti::Color::black) && ((icon == ' ') || (fg == gtti::Color::black))) return;
-
-	// draw char
-	m_renderer->setChar(x, y, icon);
-
-	if (m_render->get(x, y)->discover.flags & D_SEEN) {
-		m_renderer->setCharForeground(x, y, fg.toColor());
-		m_renderer->setCharBackground(x, y, bg.toColor());
-	} else if (m_render->get(x, y)->discover.flags & D_EXPLORED) {
-		m_renderer->setCharForeground(x, y, gtti::Color(31, 31, 31).toColor());
-		m_renderer->setCharBackground(x, y, gtti::Color::black.toColor());
+	if (m_showMemory) {
+		m_memory->show();
 	} else {
-		m_renderer->setCharForeground(x, y, gtti::Color::black.toColor());
-		m_renderer->setCharBackground(x, y, gtti::Color::black.toColor());
+		m_memory->hide();
 	}
 }
 
-void RenderThread::drawFull(int x, int y) const
+void RenderThread::drawMemory()
 {
-    gtti::Color fg = m_render->get(x, y)->tile.fgColor;
-    gtti::Color bg = m_render->get(x, y)->tile.bgColor;
-	int icon = m_render->get(x, y)->tile.icon;
+	char line[64];
+	int y = 0;
 
-	m_renderer->setChar(x, y, icon);
-	m_renderer->setCharForeground(x, y, fg.toColor());
-	m_renderer->setCharBackground(x, y, bg.toColor());
-}
+	m_memory->clear();
 
-void RenderThread::drawStealth(int x, int y) const
-{
-}
+	snprintf(line, sizeof(line), "%-12s %10s %10s %8s", "subsystem", "current", "peak", "allocs");
+	print(m_memory, 0, y++, line, gtti::Color::grey);
 
-void RenderThread::drawDebugDiscovery(int x, int y) const
-{
-}
+	for (int i = 0; i < sys::MEM_TAGS; i++) {
+		sys::mem_stats s = sys::mem_usage((sys::mem_tag)i);
 
-void RenderThread::drawDebugPathing(int x, int y) const
-{
-#if 0
-	static const short sMAX_DEBUG_PATH_LEN = 15;
-	short val = *g_distMap.at(x, y);
-
-	if (val > sMAX_DEBUG_PATH_LEN) {
-		val = sMAX_DEBUG_PATH_LEN;
+		snprintf(line, sizeof(line), "%-12s %9zuK %9zuK %8zu",
+				 sys::mem_tagname((sys::mem_tag)i), s.current / 1024, s.peak / 1024, s.allocs);
+		print(m_memory, 0, y++, line, gtti::Color::white);
 	}
 
-	float f = (float)val / (float)sMAX_DEBUG_PATH_LEN;
-	int icon = m_render->get(x, y)->tile.icon;
-
-	m_renderer->setChar(x, y, icon);
-	m_renderer->setCharForeground(x, y, TCODColor::lighterGrey);
-	m_renderer->setCharBackground(x, y, TCODColor::lerp(TCODColor::red, TCODColor::black, f));
-#endif
+	snprintf(line, sizeof(line), "%-12s %9zuK", "total", sys::mem_total() / 1024);
+	print(m_memory, 0, y++, line, gtti::Color::gold);
 }
 
 void RenderThread::done(bool d)
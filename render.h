@@ -5,6 +5,7 @@
 #include "context.h"
 #include "key.h"
 #include "ui/ui.h"
+#include "shading.h"
 
 enum RenderMode
 {
@@ -31,22 +32,25 @@ public:
 
 	static void ev_render(void *tag, const sys::token_id id);
 
+	// shows the last drawn frame again, nothing is composited or recorded
+	void present();
+
+	// toggles the memory usage overlay
+	void toggleMemory();
+
 protected:
 
 	virtual void render();
 
-	void draw(int x, int y) const;
+	// shades the whole viewport for m_mode and writes it to the console
+	void drawViewport();
 
-	void drawNormal(int x, int y) const;
-	void drawTruecolor(int x, int y) const;
-	void drawStealth(int x, int y) const;
-	void drawFull(int x, int y) const;
-	void drawDebugDiscovery(int x, int y) const;
-	void drawDebugPathing(int x, int y) const;
+	void drawMemory();
 
 protected:
 
-	RenderSettings *m_render;
+	// the planes of the snapshot being drawn
+	const RenderPlanes *m_render;
     Console* m_console;
 
 	ui::canvas* m_rootCanvas;
@@ -62,8 +66,11 @@ protected:
 	Point m_playerPos;
 	Tile m_playerTile;
     Console *m_cursor;
+    Console *m_memory;
 
 	RenderMode m_mode;
+	ViewportShader m_shader;
 
 	bool m_done;
+	bool m_showMemory;
 };
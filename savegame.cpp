@@ -0,0 +1,329 @@
+#include "savegame.h"
+#include "context.h"
+#include "map.h"
+#include "player.h"
+
+#include "sys/logger.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char SaveGame::sMAGIC[4] = { 'G', 'T', 'T', 'I' };
+const uint16_t SaveGame::sVERSION = 2;
+const uint32_t SaveGame::sMAX_ENTITIES = 65536;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+	// XORs every stride-sized element with the one before it, then replaces
+	// runs of zero bytes with (0, length)
+	void encode(const void* data, size_t stride, size_t count, std::vector<unsigned char>& out)
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		size_t n = stride * count;
+		unsigned int zeros = 0;
+
+		out.clear();
+
+		for (size_t i = 0; i < n; i++) {
+			unsigned char d = p[i] ^ (i >= stride ? p[i - stride] : 0);
+
+			if (d == 0) {
+				if (++zeros == 255) {
+					out.push_back(0);
+					out.push_back(255);
+					zeros = 0;
+				}
+				continue;
+			}
+
+			if (zeros) {
+				out.push_back(0);
+				out.push_back((unsigned char)zeros);
+				zeros = 0;
+			}
+
+			out.push_back(d);
+		}
+
+		if (zeros) {
+			out.push_back(0);
+			out.push_back((unsigned char)zeros);
+		}
+	}
+
+	// the inverse of encode, returns false if in does not hold exactly
+	// stride * count bytes
+	bool decode(const std::vector<unsigned char>& in, void* data, size_t stride, size_t count)
+	{
+		unsigned char* p = (unsigned char*)data;
+		size_t n = stride * count;
+		size_t o = 0;
+
+		for (size_t i = 0; i < in.size(); i++) {
+			if (in[i] == 0) {
+				if (++i == in.size()) return false;
+
+				size_t run = in[i];
+				if (o + run > n) return false;
+
+				memset(p + o, 0, run);
+				o += run;
+			} else {
+				if (o == n) return false;
+
+				p[o++] = in[i];
+			}
+		}
+
+		if (o != n) return false;
+
+		for (size_t i = stride; i < n; i++) {
+			p[i] ^= p[i - stride];
+		}
+
+		return true;
+	}
+
+	bool writeBlock(FILE* fp, const void* data, size_t stride, size_t count)
+	{
+		std::vector<unsigned char> block;
+		encode(data, stride, count, block);
+
+		uint32_t len = (uint32_t)block.size();
+
+		if (fwrite(&len, sizeof(len), 1, fp) != 1) return false;
+		if (len && (fwrite(&block[0], 1, len, fp) != len)) return false;
+
+		return true;
+	}
+
+	bool readBlock(FILE* fp, void* data, size_t stride, size_t count)
+	{
+		uint32_t len = 0;
+
+		if (fread(&len, sizeof(len), 1, fp) != 1) return false;
+
+		// encode never writes more than 2 bytes for each one it is given
+		if (len > 2 * stride * count) return false;
+
+		std::vector<unsigned char> block(len);
+		if (len && (fread(&block[0], 1, len, fp) != len)) return false;
+
+		return decode(block, data, stride, count);
+	}
+
+	Object* recreate(ObjectKind kind, const Point& p, float level, int radius)
+	{
+		switch (kind) {
+		case O_MAGIC_TREE:		return new MagicTree(p);
+		case O_MAGIC_SHROOM:	return new MagicShroom(p);
+		case O_TORCH:			return new Torch(p.x(), p.y(), level, radius);
+		case O_WISP:			return new Wisp(p);
+		default: break;
+		}
+		return static_cast<Object*>(0);
+	}
+
+	FILE* open(const std::string& path, const char* mode)
+	{
+		FILE* fp = NULL;
+#ifdef __PLATFORM_WIN32__
+		fopen_s(&fp, path.c_str(), mode);
+#else
+		fp = fopen(path.c_str(), mode);
+#endif
+		return fp;
+	}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SaveGame::SaveGame() :
+	m_running(false),
+	m_done(false),
+	m_ok(false),
+	m_planes(NULL)
+{
+}
+
+SaveGame::~SaveGame()
+{
+	if (m_running) {
+		m_worker.join();
+	}
+
+	delete m_planes;
+}
+
+bool SaveGame::finished()
+{
+	if (m_running && m_done) {
+		m_worker.join();
+		m_running = false;
+	}
+
+	return !m_running;
+}
+
+bool SaveGame::save(const std::string& path, Context* ctx, Map* map, Player* player)
+{
+	if (!finished()) return false;
+
+	RenderPlanes* planes = ctx->planes();
+
+	if (!m_planes || (m_planes->size() != planes->size())) {
+		delete m_planes;
+		m_planes = new RenderPlanes(planes->width(), planes->height());
+	}
+
+	// everything the writer needs is copied here, after this the game is free
+	// to carry on
+	m_planes->copy(planes, P_TILE | P_LIGHTING | P_DISCOVERY | P_MOBILITY);
+	m_kinds = map->staticKinds();
+	m_statics = map->staticTiles();
+
+	m_entities.clear();
+
+	EntityStore::iterator it = ctx->entities()->begin();
+	for (; it != ctx->entities()->end(); it++) {
+		const Object* obj = *it;
+
+		if (obj->kind() == O_NONE) continue;
+
+		EntityRecord r;
+		memset(&r, 0, sizeof(r));
+
+		r.kind = (uint16_t)obj->kind();
+		r.x = (int16_t)obj->coords().x();
+		r.y = (int16_t)obj->coords().y();
+
+		if (obj->light()) {
+			r.level = obj->light()->lightLevel;
+			r.radius = (int16_t)obj->light()->radius;
+		}
+
+		m_entities.push_back(r);
+	}
+
+	memset(&m_header, 0, sizeof(m_header));
+	memcpy(m_header.magic, sMAGIC, sizeof(sMAGIC));
+	m_header.version = sVERSION;
+	m_header.width = (uint16_t)planes->width();
+	m_header.height = (uint16_t)planes->height();
+	m_header.px = (int16_t)player->coords().x();
+	m_header.py = (int16_t)player->coords().y();
+	m_header.entities = (uint32_t)m_entities.size();
+
+	m_path = path;
+	m_ok = false;
+	m_done = false;
+	m_running = true;
+
+	m_worker.work(this);
+
+	return true;
+}
+
+void SaveGame::work()
+{
+	FILE* fp = open(m_path, "wb");
+
+	if (!fp) {
+		sys::logger::log("save: could not open %s", m_path.c_str());
+		m_done = true;
+		return;
+	}
+
+	size_t cells = m_planes->size().area();
+
+	bool ok = (fwrite(&m_header, sizeof(m_header), 1, fp) == 1);
+
+	ok = ok && writeBlock(fp, &m_kinds[0], 1, m_kinds.size());
+	ok = ok && writeBlock(fp, &m_statics[0], sizeof(Tile), m_statics.size());
+	ok = ok && writeBlock(fp, m_planes->tiles()->get(0, 0), sizeof(Tile), cells);
+	ok = ok && writeBlock(fp, m_planes->lighting()->get(0, 0), sizeof(LightingModel), cells);
+	ok = ok && writeBlock(fp, m_planes->discovery()->get(0, 0), sizeof(DiscoveryModel), cells);
+	ok = ok && writeBlock(fp, m_planes->mobility()->get(0, 0), sizeof(MobilityModel), cells);
+
+	if (ok && !m_entities.empty()) {
+		ok = writeBlock(fp, &m_entities[0], sizeof(EntityRecord), m_entities.size());
+	}
+
+	fclose(fp);
+
+	m_ok = ok;
+	m_done = true;
+}
+
+bool SaveGame::load(const std::string& path, Context* ctx, Map* map, Player* player)
+{
+	FILE* fp = open(path, "rb");
+
+	if (!fp) return false;
+
+	Header h;
+	bool ok = (fread(&h, sizeof(h), 1, fp) == 1);
+
+	ok = ok && (memcmp(h.magic, sMAGIC, sizeof(sMAGIC)) == 0) && (h.version == sVERSION);
+	ok = ok && (h.width == map->width()) && (h.height == map->height());
+	ok = ok && (h.entities <= sMAX_ENTITIES);
+
+	// nothing is sized from the file until the header checks out
+	if (!ok) {
+		fclose(fp);
+		sys::logger::log("load: %s is not a valid save", path.c_str());
+		return false;
+	}
+
+	// decode everything before touching the game, so a bad file changes nothing
+	size_t cells = (size_t)h.width * h.height;
+	RenderPlanes planes(h.width, h.height);
+	std::vector<unsigned char> kinds(cells);
+	std::vector<Tile> statics(cells);
+	std::vector<EntityRecord> entities(h.entities);
+
+	ok = ok && readBlock(fp, &kinds[0], 1, cells);
+
+	// every cell has to hold something the map knows how to make
+	for (size_t i = 0; ok && (i < cells); i++) {
+		ok = (kinds[i] >= Map::K_DIRT) && (kinds[i] <= Map::K_GRASS);
+	}
+
+	ok = ok && readBlock(fp, &statics[0], sizeof(Tile), cells);
+	ok = ok && readBlock(fp, planes.tiles()->list(), sizeof(Tile), cells);
+	ok = ok && readBlock(fp, planes.lighting()->list(), sizeof(LightingModel), cells);
+	ok = ok && readBlock(fp, planes.discovery()->list(), sizeof(DiscoveryModel), cells);
+	ok = ok && readBlock(fp, planes.mobility()->list(), sizeof(MobilityModel), cells);
+
+	if (ok && !entities.empty()) {
+		ok = readBlock(fp, &entities[0], sizeof(EntityRecord), entities.size());
+	}
+
+	fclose(fp);
+
+	if (!ok) {
+		sys::logger::log("load: %s is not a valid save", path.c_str());
+		return false;
+	}
+
+	map->restore(kinds, statics);
+	player->teleport(Point(h.px, h.py));
+
+	// a fresh context around the player, then the saved planes on top of it
+	ctx->initialize(map);
+	ctx->planes()->copy(&planes, P_TILE | P_LIGHTING | P_DISCOVERY | P_MOBILITY);
+
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		const EntityRecord& r = entities[i];
+		Object* obj = recreate((ObjectKind)r.kind, Point(r.x, r.y), r.level, r.radius);
+
+		if (obj && !ctx->place(obj).valid()) {
+			delete obj;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.h"
+
+#include "sys/worker.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class Context;
+class Map;
+class Player;
+
+// A save of a context and its map.  The file is a small header followed by
+// flat blocks, so loading is a handful of bulk reads straight into plane
+// storage:
+//
+//   header    magic, version, map size, player position
+//   kinds     the Map::StaticKind of every cell
+//   statics   the tile of every static object
+//   planes    the tile, lighting, discovery and mobility planes
+//   entities  one EntityRecord per dynamic object
+//
+// Every block is delta encoded (each cell XOR'd with the cell before it) and
+// then run-length encoded, so uniform stretches of map cost next to nothing.
+//
+// Saving captures the state under the context lock with plain plane copies
+// and then encodes and writes it on a background worker, so the game keeps
+// running while the file is written.
+class SaveGame : public sys::workable
+{
+public:
+	SaveGame();
+	~SaveGame();
+
+	// captures ctx, map and player (the caller must hold the context lock)
+	// and starts writing path in the background.  Returns false if a save is
+	// still being written
+	bool save(const std::string& path, Context* ctx, Map* map, Player* player);
+
+	// true when no save is being written
+	bool finished();
+
+	// true if the last save was written in full
+	bool succeeded() const { return m_ok; }
+
+	// replaces the state of map, player and ctx with the save at path.  The
+	// caller must hold the context lock.  Returns false (and leaves
+	// everything untouched) if the file is missing or not a save of a map
+	// this size
+	static bool load(const std::string& path, Context* ctx, Map* map, Player* player);
+
+	void work();
+
+protected:
+
+	struct EntityRecord
+	{
+		uint16_t kind;
+		int16_t x, y;
+		int16_t radius;
+		float level;
+	};
+
+	struct Header
+	{
+		char magic[4];
+		uint16_t version;
+		uint16_t width, height;
+		int16_t px, py;
+		uint16_t reserved;
+		uint32_t entities;
+	};
+
+	static const char sMAGIC[4];
+	static const uint16_t sVERSION;
+
+	// more entities than this and the file is taken to be bad
+	static const uint32_t sMAX_ENTITIES;
+
+	sys::worker m_worker;
+	bool m_running;
+	std::atomic<bool> m_done;
+	bool m_ok;
+
+	// the state being written
+	std::string m_path;
+	Header m_header;
+	std::vector<unsigned char> m_kinds;
+	std::vector<Tile> m_statics;
+	RenderPlanes* m_planes;
+	std::vector<EntityRecord> m_entities;
+};
@@ -0,0 +1,169 @@
+#include "scheduler.h"
+#include "context.h"
+
+const int Actor::sNORMAL_SPEED = 10;
+const int Actor::sACTION_COST = 100;
+
+const int Scheduler::sTURN_TICKS = 10;
+const unsigned int Scheduler::sMIN_PARALLEL = 16;
+
+namespace {
+
+	thread_local bool t_thinking = false;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::ThinkJob::work()
+{
+	t_thinking = true;
+
+	for (size_t i = begin; i < end; i++) {
+		(*batch)[i]->think(world);
+	}
+
+	t_thinking = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Scheduler::Scheduler(sys::worker_pool* workers) :
+	m_now(0),
+	m_nextId(1),
+	m_workers(workers)
+{
+	// the calling thread takes a share of every batch as well
+	m_jobs.resize((m_workers ? m_workers->size() : 0) + 1);
+}
+
+Scheduler::~Scheduler()
+{
+}
+
+bool Scheduler::thinking()
+{
+	return t_thinking;
+}
+
+unsigned int Scheduler::add(Actor* a)
+{
+	if (!Utils::isValid(a)) return 0;
+
+	unsigned int id = m_nextId++;
+	Record& r = m_actors[id];
+
+	r.actor = a;
+	r.energy = 0;
+
+	schedule(id, r);
+
+	return id;
+}
+
+void Scheduler::remove(unsigned int id)
+{
+	// queued entries of removed actors are dropped when they come up
+	m_actors.erase(id);
+}
+
+void Scheduler::schedule(unsigned int id, Record& r)
+{
+	int speed = std::max(r.actor->speed(), 1);
+	int wait = 0;
+
+	if (r.energy < Actor::sACTION_COST) {
+		wait = (Actor::sACTION_COST - r.energy + speed - 1) / speed;
+	}
+
+	// the energy gained while waiting is banked up front
+	r.energy += wait * speed;
+
+	Entry e;
+	e.due = m_now + wait;
+	e.id = id;
+
+	m_queue.push(e);
+}
+
+void Scheduler::run(Context* ctx, int ticks)
+{
+	unsigned long long end = m_now + ticks;
+
+	while (!m_queue.empty() && (m_queue.top().due < end)) {
+		m_now = m_queue.top().due;
+
+		// gather everything due on this tick
+		m_batch.clear();
+		m_batchIds.clear();
+
+		while (!m_queue.empty() && (m_queue.top().due == m_now)) {
+			unsigned int id = m_queue.top().id;
+			m_queue.pop();
+
+			std::unordered_map<unsigned int, Record>::iterator it = m_actors.find(id);
+
+			if (it != m_actors.end()) {
+				m_batch.push_back(it->second.actor);
+				m_batchIds.push_back(id);
+			}
+		}
+
+		think(ctx->planes());
+
+		// act serially, in scheduling order; an actor may remove others
+		for (unsigned int i = 0; i < m_batch.size(); i++) {
+			std::unordered_map<unsigned int, Record>::iterator it = m_actors.find(m_batchIds[i]);
+
+			if (it != m_actors.end()) {
+				Record& r = it->second;
+
+				// every action costs something, or a free one would be
+				// rescheduled on this same tick forever
+				r.energy -= std::max(r.actor->act(ctx), 1);
+				schedule(it->first, r);
+			}
+		}
+	}
+
+	m_now = end;
+}
+
+void Scheduler::think(const RenderPlanes* world)
+{
+	size_t n = m_batch.size();
+
+	if (n == 0) return;
+
+	if ((!m_workers) || (n < sMIN_PARALLEL)) {
+		ThinkJob job;
+		job.batch = &m_batch;
+		job.world = world;
+		job.end = n;
+		job.work();
+		return;
+	}
+
+	// split the batch evenly, the last slice is ours
+	size_t slices = m_jobs.size();
+	size_t per = (n + slices - 1) / slices;
+
+	for (size_t i = 0; i < slices; i++) {
+		ThinkJob& job = m_jobs[i];
+
+		job.batch = &m_batch;
+		job.world = world;
+		job.begin = std::min(i * per, n);
+		job.end = std::min(job.begin + per, n);
+	}
+
+	for (size_t i = 0; i < m_workers->size(); i++) {
+		if (m_jobs[i].begin == m_jobs[i].end) break;
+
+		m_workers->start(i, &m_jobs[i]);
+	}
+
+	m_jobs[slices - 1].work();
+
+	m_workers->wait();
+}
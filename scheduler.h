@@ -0,0 +1,119 @@
+#pragma once
+
+#include "common.h"
+
+#include "sys/worker.h"
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+
+class Context;
+
+// Anything which takes turns.  A turn is split in two: think() plans the
+// action against a read-only view of the world and may run on any thread
+// alongside other actors; act() carries it out and always runs serially, in
+// a deterministic order
+class Actor
+{
+public:
+	Actor() {}
+	virtual ~Actor() {}
+
+	// must not modify anything shared, the world is only valid for reading
+	// (sight is tested with LineOfSight::sees, the cached los() is for act)
+	virtual void think(const RenderPlanes* world) = 0;
+
+	// performs the planned action, returning its energy cost
+	virtual int act(Context* ctx) = 0;
+
+	// energy gained per tick, sNORMAL_SPEED acts once per player turn
+	virtual int speed() const { return sNORMAL_SPEED; }
+
+	static const int sNORMAL_SPEED;
+	static const int sACTION_COST;
+};
+
+// An energy based turn scheduler.  Actors gain speed() energy per tick and
+// act whenever they have sACTION_COST; the actors due on the same tick are
+// run as one batch, thinking in parallel on a pool of workers and then
+// acting one by one in the order they were scheduled.
+class Scheduler
+{
+public:
+	// workers (not owned, outlives us) think alongside the calling thread,
+	// NULL thinks on the calling thread only
+	explicit Scheduler(sys::worker_pool* workers = NULL);
+	~Scheduler();
+
+	// starts scheduling a, which must stay alive until it is removed.  The
+	// returned id is used to remove it again
+	unsigned int add(Actor* a);
+	void remove(unsigned int id);
+
+	// runs every actor due within the next ticks (one player turn by default)
+	void run(Context* ctx, int ticks = sTURN_TICKS);
+
+	size_t size() const { return m_actors.size(); }
+
+	// true on a thread while it runs Actor::think()
+	static bool thinking();
+	unsigned long long now() const { return m_now; }
+
+	// ticks in one player turn
+	static const int sTURN_TICKS;
+
+	// batches smaller than this think on the calling thread only
+	static const unsigned int sMIN_PARALLEL;
+
+protected:
+
+	struct Entry
+	{
+		unsigned long long due;
+		unsigned int id;
+
+		// earliest due first, ties in scheduling order
+		bool operator>(const Entry& rhs) const
+		{
+			return ((due > rhs.due) || ((due == rhs.due) && (id > rhs.id)));
+		}
+	};
+
+	struct Record
+	{
+		Actor* actor;
+		int energy;
+	};
+
+	// a slice of a batch thought about on one worker
+	class ThinkJob : public sys::workable
+	{
+	public:
+		ThinkJob() : batch(NULL), world(NULL), begin(0), end(0) {}
+
+		void work();
+
+		const std::vector<Actor*>* batch;
+		const RenderPlanes* world;
+		size_t begin, end;
+	};
+
+	void schedule(unsigned int id, Record& r);
+	void think(const RenderPlanes* world);
+
+	typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > Queue;
+
+	Queue m_queue;
+	std::unordered_map<unsigned int, Record> m_actors;
+
+	unsigned long long m_now;
+	unsigned int m_nextId;
+
+	// the batch being run, by scheduling order
+	std::vector<Actor*> m_batch;
+	std::vector<unsigned int> m_batchIds;
+
+	sys::worker_pool* m_workers;
+	std::vector<ThinkJob> m_jobs;
+};
@@ -0,0 +1,239 @@
+#include "shading.h"
+#include "colorbatch.h"
+
+#include <algorithm>
+
+namespace {
+
+	const float sAMBIENT_MAX = 0.75f;
+	const float sAMBIENT_MIN = 0.35f;
+
+	inline void copy(const std::vector<float>* from, float* const* to, int n)
+	{
+		for (int c = 0; c < 3; c++) {
+			std::copy(from[c].begin(), from[c].begin() + n, to[c]);
+		}
+	}
+
+	inline float select(bool c, float a, float b)
+	{
+		return (c ? a : b);
+	}
+
+}
+
+ViewportShader::ViewportShader() :
+	m_width(0), m_height(0)
+{
+}
+
+ViewportShader::~ViewportShader()
+{
+	resize(0, 0);
+}
+
+void ViewportShader::resize(int w, int h)
+{
+	if ((w == m_width) && (h == m_height)) return;
+
+	// 8 byte planes (glyph, write, 3 out fg, 3 out bg), 28 four byte float
+	// and int planes (fg, bg, light, result fg and bg, lit fg and bg and fog
+	// at 3 each, ambient, discovery, lighting, percent)
+	static const size_t sCELL = 8 * sizeof(unsigned char) + 28 * sizeof(float);
+
+	sys::mem_untrack(sys::MEM_RENDER, size() * sCELL);
+
+	m_width = w;
+	m_height = h;
+
+	size_t n = size();
+
+	glyph.resize(n);
+	write.resize(n);
+	m_ambient.resize(n);
+	m_discovery.resize(n);
+	m_lighting.resize(n);
+	m_percent.resize(n);
+
+	for (int c = 0; c < 3; c++) {
+		outFg[c].resize(n);
+		outBg[c].resize(n);
+		m_fg[c].resize(n);
+		m_bg[c].resize(n);
+		m_light[c].resize(n);
+		m_resFg[c].resize(n);
+		m_resBg[c].resize(n);
+		m_litFg[c].resize(n);
+		m_litBg[c].resize(n);
+		m_fog[c].resize(n);
+	}
+
+	sys::mem_track(sys::MEM_RENDER, size() * sCELL);
+}
+
+void ViewportShader::load(const RenderPlanes* planes)
+{
+	resize(planes->width(), planes->height());
+
+	const Tile* tiles = planes->tiles()->get(0, 0);
+	const LightingModel* lighting = planes->lighting()->get(0, 0);
+	const DiscoveryModel* discovery = planes->discovery()->get(0, 0);
+
+	const int n = size();
+
+	// the one pass over the (array of structure) planes
+	for (int i = 0; i < n; i++) {
+		const Tile& t = tiles[i];
+		const LightingModel& lm = lighting[i];
+
+		glyph[i] = (unsigned char)t.icon;
+
+		m_fg[0][i] = (float)t.fgColor.r();
+		m_fg[1][i] = (float)t.fgColor.g();
+		m_fg[2][i] = (float)t.fgColor.b();
+
+		m_bg[0][i] = (float)t.bgColor.r();
+		m_bg[1][i] = (float)t.bgColor.g();
+		m_bg[2][i] = (float)t.bgColor.b();
+
+		m_ambient[i] = lm.ambientColor.average();
+
+		m_light[0][i] = (float)lm.lightColor.r();
+		m_light[1][i] = (float)lm.lightColor.g();
+		m_light[2][i] = (float)lm.lightColor.b();
+
+		m_lighting[i] = lm.flags;
+		m_discovery[i] = discovery[i].flags;
+	}
+
+	float* light[3] = { m_light[0].data(), m_light[1].data(), m_light[2].data() };
+	gtti::batch::smooth(light, n);
+}
+
+void ViewportShader::store(const float* const* fg, const float* const* bg)
+{
+	unsigned char* ofg[3] = { outFg[0].data(), outFg[1].data(), outFg[2].data() };
+	unsigned char* obg[3] = { outBg[0].data(), outBg[1].data(), outBg[2].data() };
+
+	gtti::batch::store(fg, ofg, size());
+	gtti::batch::store(bg, obg, size());
+}
+
+void ViewportShader::shadeNormal()
+{
+	const int n = size();
+
+	float* rfg[3] = { m_resFg[0].data(), m_resFg[1].data(), m_resFg[2].data() };
+	float* rbg[3] = { m_resBg[0].data(), m_resBg[1].data(), m_resBg[2].data() };
+	float* lfg[3] = { m_litFg[0].data(), m_litFg[1].data(), m_litFg[2].data() };
+	float* lbg[3] = { m_litBg[0].data(), m_litBg[1].data(), m_litBg[2].data() };
+	float* fog[3] = { m_fog[0].data(), m_fog[1].data(), m_fog[2].data() };
+	const float* light[3] = { m_light[0].data(), m_light[1].data(), m_light[2].data() };
+	float* pct = m_percent.data();
+
+	// some ambient (dark, but visible) value - scaled by tile ambient light
+	for (int i = 0; i < n; i++) {
+		pct[i] = std::max(sAMBIENT_MIN, std::min(sAMBIENT_MAX, m_ambient[i] / 255.0f));
+	}
+
+	// dark - the colors at the ambient level
+	copy(m_fg, rfg, n);
+	copy(m_bg, rbg, n);
+	gtti::batch::darken(rfg, pct, n);
+	gtti::batch::darken(rbg, pct, n);
+
+	// fog - the foreground color darker still
+	for (int i = 0; i < n; i++) {
+		pct[i] -= sAMBIENT_MIN;
+	}
+
+	copy(m_fg, fog, n);
+	gtti::batch::darken(fog, pct, n);
+
+	// lit - the colors at the given light level
+	copy(m_fg, lfg, n);
+	copy(m_bg, lbg, n);
+	gtti::batch::multiply(lfg, light, n);
+	gtti::batch::multiply(lbg, light, n);
+
+	for (int i = 0; i < n; i++) {
+		unsigned int d = m_discovery[i];
+		unsigned int l = m_lighting[i];
+
+		bool seen = ((d & D_SEEN) != 0);
+		bool explored = ((d & D_EXPLORED) != 0);
+		bool lit = ((l & L_LIT) != 0);
+		bool always = ((l & L_ALWAYS_LIT) != 0);
+		bool fogged = (((l & L_TRANSPARENT) != 0) && !always);
+
+		// which color ends up in the cell
+		bool useLit = (seen && lit);
+		bool useDark = ((seen && !lit && explored) || (!seen && explored && !fogged));
+		bool useFog = (!seen && explored && fogged);
+		bool useFull = (seen && explored && always);
+
+		for (int c = 0; c < 3; c++) {
+			float df = rfg[c][i];
+			float db = rbg[c][i];
+			float fg = fog[c][i];
+
+			// lit is never darker than the ambient color
+			float lf = std::min(255.0f, std::max(df, lfg[c][i]));
+			float lb = std::min(255.0f, std::max(db, lbg[c][i]));
+
+			float of = select(useLit, lf, select(useDark, df, select(useFog, fg, 0.0f)));
+			float ob = select(useLit, lb, select(useDark, db, select(useFog, fg, 0.0f)));
+
+			rfg[c][i] = select(useFull, m_fg[c][i], of);
+			rbg[c][i] = ob;
+		}
+
+		write[i] = 1;
+	}
+
+	store(rfg, rbg);
+}
+
+void ViewportShader::shadeTruecolor()
+{
+	const int n = size();
+
+	float* rfg[3] = { m_resFg[0].data(), m_resFg[1].data(), m_resFg[2].data() };
+	float* rbg[3] = { m_resBg[0].data(), m_resBg[1].data(), m_resBg[2].data() };
+
+	for (int i = 0; i < n; i++) {
+		unsigned int d = m_discovery[i];
+
+		bool seen = ((d & D_SEEN) != 0);
+		bool explored = ((d & D_EXPLORED) != 0);
+
+		bool blackBg = ((m_bg[0][i] == 0.0f) && (m_bg[1][i] == 0.0f) && (m_bg[2][i] == 0.0f));
+		bool blackFg = ((m_fg[0][i] == 0.0f) && (m_fg[1][i] == 0.0f) && (m_fg[2][i] == 0.0f));
+
+		// nothing to draw - no background, and either no glyph or no color
+		// for it
+		write[i] = !(blackBg && ((glyph[i] == ' ') || blackFg));
+
+		for (int c = 0; c < 3; c++) {
+			rfg[c][i] = select(seen, m_fg[c][i], select(explored, 31.0f, 0.0f));
+			rbg[c][i] = select(seen, m_bg[c][i], 0.0f);
+		}
+	}
+
+	store(rfg, rbg);
+}
+
+void ViewportShader::shadeFull()
+{
+	const float* fg[3] = { m_fg[0].data(), m_fg[1].data(), m_fg[2].data() };
+	const float* bg[3] = { m_bg[0].data(), m_bg[1].data(), m_bg[2].data() };
+
+	std::fill(write.begin(), write.end(), 1);
+
+	store(fg, bg);
+}
+
+void ViewportShader::shadeNone()
+{
+	std::fill(write.begin(), write.end(), 0);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "common.h"
+
+#include <vector>
+
+// Shades the whole viewport at once.  load() gathers what shading needs from
+// the render planes into flat arrays (one per channel), then one kernel per
+// render mode works out the final colors of every cell with the
+// gtti::batch kernels and a final select loop without branches.
+//
+//		shader.load(planes);
+//		shader.shadeNormal();
+//		for (i...) if (shader.write[i]) draw(shader.glyph[i], shader.fg(i), shader.bg(i));
+//
+class ViewportShader
+{
+public:
+	ViewportShader();
+	~ViewportShader();
+
+	void load(const RenderPlanes* planes);
+
+	// R_NORMAL - light, ambient light and fog of war
+	void shadeNormal();
+	// R_TRUECOLOR - every seen cell in full color
+	void shadeTruecolor();
+	// R_FULL - every cell in full color
+	void shadeFull();
+	// modes which draw nothing
+	void shadeNone();
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	int size() const { return m_width * m_height; }
+
+	inline ::Color fg(int i) const;
+	inline ::Color bg(int i) const;
+
+public:
+
+	// outputs - the icon, colors and if the cell should be drawn at all
+	std::vector<unsigned char> glyph;
+	std::vector<unsigned char> write;
+	std::vector<unsigned char> outFg[3];
+	std::vector<unsigned char> outBg[3];
+
+protected:
+
+	void resize(int w, int h);
+
+	// normalizes (like gtti::Color::toColor) and stores the colors
+	void store(const float* const* fg, const float* const* bg);
+
+	int m_width;
+	int m_height;
+
+	// inputs
+	std::vector<float> m_fg[3];
+	std::vector<float> m_bg[3];
+	std::vector<float> m_ambient;		// average of the ambient color
+	std::vector<float> m_light[3];		// smoothed light color
+	std::vector<unsigned int> m_discovery;
+	std::vector<unsigned int> m_lighting;
+
+	// scratch
+	std::vector<float> m_resFg[3];
+	std::vector<float> m_resBg[3];
+	std::vector<float> m_litFg[3];
+	std::vector<float> m_litBg[3];
+	std::vector<float> m_fog[3];
+	std::vector<float> m_percent;
+};
+
+inline
+::Color ViewportShader::fg(int i) const
+{
+	::Color c = { outFg[0][i], outFg[1][i], outFg[2][i], 255 };
+	return c;
+}
+
+inline
+::Color ViewportShader::bg(int i) const
+{
+	::Color c = { outBg[0][i], outBg[1][i], outBg[2][i], 255 };
+	return c;
+}
@@ -0,0 +1,40 @@
+#include "snapshot.h"
+
+const unsigned int SnapshotBuffer::sFRESH = 0x4;
+
+SnapshotBuffer::SnapshotBuffer(int w, int h) :
+	m_back(0),
+	m_front(1),
+	m_middle(2),
+	m_serial(0)
+{
+	for (int i = 0; i < 3; i++) {
+		m_frames[i] = new Snapshot(w, h);
+	}
+}
+
+SnapshotBuffer::~SnapshotBuffer()
+{
+	for (int i = 0; i < 3; i++) {
+		delete m_frames[i];
+	}
+}
+
+void SnapshotBuffer::publish()
+{
+	m_frames[m_back]->serial = ++m_serial;
+
+	// hand the back buffer over and take whatever was in the middle
+	m_back = (m_middle.exchange(m_back | sFRESH, std::memory_order_acq_rel) & ~sFRESH);
+}
+
+const Snapshot* SnapshotBuffer::front()
+{
+	if (m_middle.load(std::memory_order_relaxed) & sFRESH) {
+		m_front = (m_middle.exchange(m_front, std::memory_order_acq_rel) & ~sFRESH);
+	}
+
+	const Snapshot* s = m_frames[m_front];
+
+	return (s->serial ? s : static_cast<const Snapshot*>(0));
+}
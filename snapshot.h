@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+
+// Everything the renderer needs to draw one frame of the map
+struct Snapshot
+{
+	Snapshot(int w, int h) : planes(w, h), serial(0) {}
+
+	// the drawn planes of the viewport, (0, 0) is the top left of the viewport
+	RenderPlanes planes;
+
+	Rect viewport;
+	Point playerPos;
+	Tile playerTile;
+
+	// 0 until the snapshot is published for the first time
+	unsigned int serial;
+};
+
+// A triple buffered exchange of snapshots between a single writer (the update
+// thread) and a single reader (the render thread).  Neither side ever blocks:
+// the writer always owns a back buffer to fill, the reader always owns the
+// latest complete front buffer, and the two are swapped through the middle
+// buffer with one atomic exchange.
+class SnapshotBuffer
+{
+public:
+	SnapshotBuffer(int w, int h);
+	~SnapshotBuffer();
+
+	// writer only - the snapshot to fill in before publish()
+	Snapshot* back();
+
+	// writer only - makes the back snapshot the latest one
+	void publish();
+
+	// reader only - the latest published snapshot, or NULL if nothing has
+	// been published yet
+	const Snapshot* front();
+
+protected:
+
+	// set on the middle index when it holds a snapshot the reader has not seen
+	static const unsigned int sFRESH;
+
+	Snapshot* m_frames[3];
+
+	unsigned int m_back;
+	unsigned int m_front;
+	std::atomic<unsigned int> m_middle;
+
+	unsigned int m_serial;
+};
+
+inline
+Snapshot* SnapshotBuffer::back()
+{
+	return m_frames[m_back];
+}
@@ -0,0 +1,246 @@
+#include "swbackend.h"
+
+#include "sys/memstats.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+namespace gtti {
+
+namespace {
+
+// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) on every channel, like
+// raylib's BLEND_ALPHA
+inline unsigned char mix(int s, int d, int a)
+{
+    return (unsigned char)((s * a + d * (255 - a) + 127) / 255);
+}
+
+inline void blend(::Color &d, ::Color s)
+{
+    if (s.a == 255) {
+        d = s;
+    } else if (s.a != 0) {
+        d.r = mix(s.r, d.r, s.a);
+        d.g = mix(s.g, d.g, s.a);
+        d.b = mix(s.b, d.b, s.a);
+        d.a = mix(s.a, d.a, s.a);
+    }
+}
+
+inline ::Color modulate(::Color c, ::Color tint)
+{
+    c.r = (unsigned char)((c.r * tint.r) / 255);
+    c.g = (unsigned char)((c.g * tint.g) / 255);
+    c.b = (unsigned char)((c.b * tint.b) / 255);
+    c.a = (unsigned char)((c.a * tint.a) / 255);
+    return c;
+}
+
+} // namespace
+
+void software_backend::surface::resize(int w, int h)
+{
+    sys::mem_untrack(sys::MEM_RENDER, pixels.size() * sizeof(::Color));
+
+    width = w;
+    height = h;
+    pixels.assign(w * h, ::Color{ 0, 0, 0, 0 });
+
+    sys::mem_track(sys::MEM_RENDER, pixels.size() * sizeof(::Color));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+software_backend::~software_backend()
+{
+    close();
+}
+
+bool software_backend::open(int w, int h, const char *)
+{
+    _framebuffer.resize(w, h);
+    _target = &_framebuffer;
+
+    return true;
+}
+
+void software_backend::close()
+{
+    for (auto &s : _surfaces) {
+        s.second.resize(0, 0);
+    }
+
+    _surfaces.clear();
+    _framebuffer.resize(0, 0);
+    _target = nullptr;
+}
+
+backend::handle software_backend::loadTexture(Image img)
+{
+    handle h = _next++;
+    surface &s = _surfaces[h];
+    ::Color *data = GetImageData(img);
+
+    s.resize(img.width, img.height);
+    memcpy(s.pixels.data(), data, s.pixels.size() * sizeof(::Color));
+
+    free(data);
+
+    return h;
+}
+
+backend::handle software_backend::createTarget(int w, int h)
+{
+    handle t = _next++;
+
+    _surfaces[t].resize(w, h);
+
+    return t;
+}
+
+void software_backend::unload(handle h)
+{
+    auto s = _surfaces.find(h);
+    if (s == _surfaces.end()) return;
+
+    if (_target == &s->second) {
+        _target = &_framebuffer;
+    }
+
+    s->second.resize(0, 0);
+    _surfaces.erase(s);
+}
+
+void software_backend::beginFrame()
+{
+    _target = &_framebuffer;
+}
+
+void software_backend::beginTarget(handle target)
+{
+    auto s = _surfaces.find(target);
+    if (s != _surfaces.end()) {
+        _target = &s->second;
+    }
+}
+
+void software_backend::endTarget()
+{
+    _target = &_framebuffer;
+}
+
+void software_backend::clear(::Color c)
+{
+    if (_target) {
+        std::fill(_target->pixels.begin(), _target->pixels.end(), c);
+    }
+}
+
+void software_backend::fill(const Rectangle &dst, ::Color c)
+{
+    if (!_target || (c.a == 0)) return;
+
+    int x0 = std::max(0, (int)dst.x);
+    int y0 = std::max(0, (int)dst.y);
+    int x1 = std::min(_target->width, (int)(dst.x + dst.width));
+    int y1 = std::min(_target->height, (int)(dst.y + dst.height));
+
+    for (int y = y0; y < y1; y++) {
+        ::Color *row = &_target->pixels[y * _target->width];
+
+        for (int x = x0; x < x1; x++) {
+            blend(row[x], c);
+        }
+    }
+}
+
+void software_backend::draw(const surface &src, const Rectangle &r, int dx, int dy, ::Color tint)
+{
+    int sx = (int)r.x;
+    int sy = (int)r.y;
+    int w = (int)r.width;
+    int h = (int)r.height;
+
+    // clip against both surfaces
+    if (sx < 0) { dx -= sx; w += sx; sx = 0; }
+    if (sy < 0) { dy -= sy; h += sy; sy = 0; }
+    if (dx < 0) { sx -= dx; w += dx; dx = 0; }
+    if (dy < 0) { sy -= dy; h += dy; dy = 0; }
+
+    w = std::min(w, std::min(src.width - sx, _target->width - dx));
+    h = std::min(h, std::min(src.height - sy, _target->height - dy));
+
+    bool white = ((tint.r & tint.g & tint.b & tint.a) == 255);
+
+    for (int y = 0; y < h; y++) {
+        const ::Color *s = &src.pixels[(sy + y) * src.width + sx];
+        ::Color *d = &_target->pixels[(dy + y) * _target->width + dx];
+
+        for (int x = 0; x < w; x++) {
+            blend(d[x], white ? s[x] : modulate(s[x], tint));
+        }
+    }
+}
+
+void software_backend::blit(handle texture, const Rectangle &src, const Vector2 &pos, ::Color tint)
+{
+    auto s = _surfaces.find(texture);
+    if (!_target || (s == _surfaces.end())) return;
+
+    draw(s->second, src, (int)pos.x, (int)pos.y, tint);
+}
+
+void software_backend::blitTarget(handle target, const Vector2 &pos)
+{
+    auto s = _surfaces.find(target);
+    if (!_target || (s == _surfaces.end())) return;
+
+    // targets are kept the right way up, there is nothing to flip
+    Rectangle r = { 0.0f, 0.0f, (float)s->second.width, (float)s->second.height };
+
+    draw(s->second, r, (int)pos.x, (int)pos.y, ::Color{ 255, 255, 255, 255 });
+}
+
+void software_backend::save(const char *filename) const
+{
+    Image img;
+
+    img.data = (void*)_framebuffer.pixels.data();
+    img.width = _framebuffer.width;
+    img.height = _framebuffer.height;
+    img.mipmaps = 1;
+    img.format = UNCOMPRESSED_R8G8B8A8;
+
+    ExportImage(img, filename);
+}
+
+int software_backend::compare(const char *filename) const
+{
+    Image img = LoadImage(filename);
+    int diff = -1;
+
+    if (img.data && (img.width == _framebuffer.width) && (img.height == _framebuffer.height)) {
+        ::Color *data = GetImageData(img);
+
+        diff = 0;
+
+        for (size_t i = 0; i < _framebuffer.pixels.size(); i++) {
+            const ::Color &a = _framebuffer.pixels[i];
+            const ::Color &b = data[i];
+
+            if ((a.r != b.r) || (a.g != b.g) || (a.b != b.b) || (a.a != b.a)) {
+                diff++;
+            }
+        }
+
+        free(data);
+    }
+
+    UnloadImage(img);
+
+    return diff;
+}
+
+} // namespace gtti
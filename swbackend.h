@@ -0,0 +1,72 @@
+#ifndef __INCLUDE_SWBACKEND_H__
+#define __INCLUDE_SWBACKEND_H__
+
+#include "backend.h"
+
+#include <vector>
+
+namespace gtti {
+
+// A CPU rasteriser drawing into an in-memory RGBA framebuffer.  It needs no
+// display, so whole frames can be timed or compared against golden images
+// on headless machines.  Blending matches raylib's default alpha blending
+class software_backend : public backend
+{
+public:
+    struct surface
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<::Color> pixels;
+
+        void resize(int w, int h);
+    };
+
+protected:
+    std::map<handle, surface> _surfaces;
+    handle _next = 1;
+
+    surface _framebuffer;
+    surface *_target = nullptr;
+
+    void draw(const surface &src, const Rectangle &r, int dx, int dy, ::Color tint);
+
+public:
+    software_backend() = default;
+    ~software_backend();
+
+    bool open(int w, int h, const char *title);
+    void close();
+    bool closing() const { return false; }
+
+    handle loadTexture(Image img);
+    handle createTarget(int w, int h);
+    void unload(handle h);
+
+    void beginFrame();
+    void endFrame() {}
+
+    void beginTarget(handle target);
+    void endTarget();
+
+    void clear(::Color c);
+    void fill(const Rectangle &dst, ::Color c);
+    void blit(handle texture, const Rectangle &src, const Vector2 &pos, ::Color tint);
+    void blitTarget(handle target, const Vector2 &pos);
+
+    int keyPressed() { return 0; }
+
+    // the last frame drawn
+    const surface& framebuffer() const { return _framebuffer; }
+
+    // writes the framebuffer to an image file (png)
+    void save(const char *filename) const;
+
+    // number of pixels which differ between the framebuffer and an image
+    // file, or -1 if the image can not be loaded or has another size
+    int compare(const char *filename) const;
+};
+
+} // namespace gtti
+
+#endif
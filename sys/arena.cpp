@@ -0,0 +1,66 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+namespace sys {
+
+	const size_t arena::sHEADER = (sizeof(arena::chunk) + 15) & ~15;
+
+	arena::arena(size_t chunk, mem_tag tag) :
+		m_head(NULL),
+		m_chunkSize(chunk),
+		m_tag(tag),
+		m_used(0),
+		m_reserved(0)
+	{
+	}
+
+	arena::~arena()
+	{
+		clear();
+	}
+
+	void* arena::alloc(size_t size)
+	{
+		if (!size) return NULL;
+		const size_t len = (size + 15) & ~15;
+
+		if (!m_head || (m_head->used + len > m_head->size)) {
+			size_t csize = (len > m_chunkSize ? len : m_chunkSize);
+			chunk* c = (chunk*)malloc(sHEADER + csize);
+
+			if (!c) return NULL;
+
+			c->next = m_head;
+			c->size = csize;
+			c->used = 0;
+
+			m_head = c;
+			m_reserved += csize;
+
+			mem_track(m_tag, sHEADER + csize);
+		}
+
+		void* p = (char*)m_head + sHEADER + m_head->used;
+
+		m_head->used += len;
+		m_used += len;
+
+		return p;
+	}
+
+	void arena::clear()
+	{
+		while (m_head) {
+			chunk* c = m_head;
+			m_head = c->next;
+
+			mem_untrack(m_tag, sHEADER + c->size);
+			free(c);
+		}
+
+		m_used = 0;
+		m_reserved = 0;
+	}
+
+}
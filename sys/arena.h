@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+#include "memstats.h"
+
+namespace sys {
+
+	// A bump allocator.  Memory is carved out of large chunks and is only
+	// ever given back all at once, by clear() or when the arena is destroyed.
+	// Destructors of objects placed in the arena are not run by the arena
+	class arena
+	{
+	public:
+		explicit arena(size_t chunk = 64 * 1024, mem_tag tag = MEM_OTHER);
+		~arena();
+
+		// returns size bytes, 16 byte aligned
+		void* alloc(size_t size);
+
+		// frees every chunk
+		void clear();
+
+		// bytes handed out, and bytes held in chunks
+		size_t used() const { return m_used; }
+		size_t reserved() const { return m_reserved; }
+
+	protected:
+
+		struct chunk
+		{
+			chunk* next;
+			size_t size;
+			size_t used;
+		};
+
+		static const size_t sHEADER;
+
+		chunk* m_head;
+		size_t m_chunkSize;
+		mem_tag m_tag;
+
+		size_t m_used;
+		size_t m_reserved;
+
+	private:
+		arena(const arena&);
+		arena& operator=(const arena&);
+	};
+
+
+	// A free list of fixed size blocks of T, backed by an arena.  Destroyed
+	// objects are recycled by the next create() instead of going back to the
+	// heap; the memory itself is released with the arena
+	template<typename T>
+	class pool
+	{
+	public:
+		explicit pool(arena* a) : m_arena(a), m_free(NULL), m_live(0) {}
+
+		template<typename... Args>
+		T* create(Args&&... args)
+		{
+			void* p;
+
+			if (m_free) {
+				p = m_free;
+				m_free = m_free->next;
+			} else {
+				p = m_arena->alloc(sizeof(block));
+			}
+
+			m_live++;
+			return new (p) T(std::forward<Args>(args)...);
+		}
+
+		void destroy(T* obj)
+		{
+			if (!obj) return;
+
+			obj->~T();
+
+			node* n = reinterpret_cast<node*>(obj);
+			n->next = m_free;
+			m_free = n;
+
+			m_live--;
+		}
+
+		// forgets every block, call this when the arena is cleared
+		void clear()
+		{
+			m_free = NULL;
+			m_live = 0;
+		}
+
+		unsigned int live() const { return m_live; }
+
+	protected:
+
+		struct node
+		{
+			node* next;
+		};
+
+		union block
+		{
+			node n;
+			char t[sizeof(T)];
+		};
+
+		arena* m_arena;
+		node* m_free;
+		unsigned int m_live;
+	};
+
+}
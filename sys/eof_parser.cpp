@@ -668,7 +668,7 @@ namespace sys {
 
 	///////////////////////////////////////////////////////////////////////////
 
-	EParser::EParser(const char* filename)
+	EParser::EParser(const char* filename) : m_tracked(0)
 	{
 #ifdef __PLATFORM_WIN32__
 		fopen_s(&m_fp, filename, "r");
@@ -689,6 +689,9 @@ namespace sys {
 			m_contents.assign(buffer);
 			delete[] buffer;
 		}
+
+		m_tracked = m_contents.capacity();
+		mem_track(MEM_PARSER, m_tracked);
 	}
 
 	EParser::EParser(const std::string& sz) : m_fp(NULL)
@@ -696,10 +699,15 @@ namespace sys {
 		resetContext();
 
 		m_contents.assign(sz);
+
+		m_tracked = m_contents.capacity();
+		mem_track(MEM_PARSER, m_tracked);
 	}
 
 	EParser::~EParser()
 	{
+		mem_untrack(MEM_PARSER, m_tracked);
+
 		if (m_fp) {
 			fclose(m_fp);
 		}
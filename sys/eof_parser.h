@@ -210,8 +210,9 @@ namespace sys {
 	class EValue : public EToken
 	{
 	public:
-		EValue() : EToken(E_VALUE) {}
-		virtual ~EValue() {}
+		EValue() : EToken(E_VALUE) { mem_track(MEM_PARSER, sizeof(EValue)); }
+		EValue(const EValue& rhs) : EToken(rhs) { mem_track(MEM_PARSER, sizeof(EValue)); }
+		virtual ~EValue() { mem_untrack(MEM_PARSER, sizeof(EValue)); }
 
 		virtual EValue* copy() = 0;
 		virtual PEValue value() = 0;
@@ -761,6 +762,9 @@ namespace sys {
 		std::string m_contents;
 		EParserContext m_context;
 
+		// bytes of m_contents accounted to MEM_PARSER
+		size_t m_tracked;
+
 	private:
 
 		// Random
@@ -1,30 +1,157 @@
 #include "memory.h"
+#include "logger.h"
 
-#pragma hdrstop
+#include <atomic>
+#include <cstring>
 
 namespace sys {
 
-	void* mem_alloc(const size_t size)
+	namespace {
+
+		struct mem_counters
+		{
+			std::atomic<size_t> current;
+			std::atomic<size_t> peak;
+			std::atomic<size_t> allocs;
+			std::atomic<size_t> frees;
+		};
+
+		mem_counters g_counters[MEM_TAGS];
+
+		const char* g_tagnames[MEM_TAGS] =
+		{
+			"other",
+			"map",
+			"grid",
+			"render",
+			"lighting",
+			"particles",
+			"ui",
+			"parser",
+		};
+
+		// every mem_alloc block starts with this header, so mem_free knows
+		// what to account
+		struct mem_header
+		{
+			size_t size;
+			mem_tag tag;
+		};
+
+		const size_t sHEADER = (sizeof(mem_header) + 15) & ~15;
+
+		inline mem_tag valid_tag(mem_tag tag)
+		{
+			return ((tag >= 0) && (tag < MEM_TAGS)) ? tag : MEM_OTHER;
+		}
+	}
+
+	void* mem_alloc(const size_t size, mem_tag tag)
 	{
 		if (!size) return NULL;
-		const int len = (size + 15) & ~15;
+		const size_t len = ((size + 15) & ~15) + sHEADER;
+
+#ifdef __PLATFORM_WIN32__
+		void* p = _aligned_malloc(len, 16);
+#else
+		void* p = NULL;
+		if (posix_memalign(&p, 16, len) != 0) p = NULL;
+#endif
+		if (!p) return NULL;
+
+		mem_header* h = (mem_header*)p;
+		h->size = size;
+		h->tag = valid_tag(tag);
+
+		mem_track(h->tag, size);
 
-		return _aligned_malloc(len, 16);
+		return ((char*)p + sHEADER);
 	}
 
 	void  mem_free(void* ptr)
 	{
 		if (ptr) {
-			_aligned_free(ptr);
+			mem_header* h = (mem_header*)((char*)ptr - sHEADER);
+
+			mem_untrack(h->tag, h->size);
+
+#ifdef __PLATFORM_WIN32__
+			_aligned_free(h);
+#else
+			free(h);
+#endif
 		}
 	}
 
-	void* mem_alloc0(const size_t size)
+	void* mem_alloc0(const size_t size, mem_tag tag)
 	{
-		void *m = mem_alloc(size);
-		memset(m, 0, size);
+		void *m = mem_alloc(size, tag);
+		if (m) memset(m, 0, size);
 
 		return m;
 	}
 
-}
\ No newline at end of file
+	void mem_track(mem_tag tag, size_t size)
+	{
+		mem_counters& c = g_counters[valid_tag(tag)];
+
+		size_t now = (c.current += size);
+		size_t peak = c.peak.load();
+
+		while ((now > peak) && !c.peak.compare_exchange_weak(peak, now)) {}
+
+		c.allocs++;
+	}
+
+	void mem_untrack(mem_tag tag, size_t size)
+	{
+		mem_counters& c = g_counters[valid_tag(tag)];
+
+		c.current -= size;
+		c.frees++;
+	}
+
+	mem_stats mem_usage(mem_tag tag)
+	{
+		mem_counters& c = g_counters[valid_tag(tag)];
+		mem_stats s;
+
+		s.current = c.current;
+		s.peak = c.peak;
+		s.allocs = c.allocs;
+		s.frees = c.frees;
+
+		return s;
+	}
+
+	size_t mem_total()
+	{
+		size_t total = 0;
+
+		for (int i = 0; i < MEM_TAGS; i++) {
+			total += g_counters[i].current;
+		}
+
+		return total;
+	}
+
+	const char* mem_tagname(mem_tag tag)
+	{
+		return g_tagnames[valid_tag(tag)];
+	}
+
+	void mem_dump()
+	{
+		logger::log("memory: %-12s %12s %12s %10s %10s", "subsystem", "current", "peak", "allocs", "frees");
+
+		for (int i = 0; i < MEM_TAGS; i++) {
+			mem_stats s = mem_usage((mem_tag)i);
+
+			logger::log("memory: %-12s %12zu %12zu %10zu %10zu",
+						mem_tagname((mem_tag)i), s.current, s.peak, s.allocs, s.frees);
+		}
+
+		logger::log("memory: %-12s %12zu", "total", mem_total());
+	}
+
+}
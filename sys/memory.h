@@ -1,12 +1,14 @@
 #pragma once
 
 #include "platform.h"
+#include "memstats.h"
 
 namespace sys {
 
-	void* mem_alloc(const size_t size);
+	// 16 byte aligned allocations, accounted to tag
+	void* mem_alloc(const size_t size, mem_tag tag = MEM_OTHER);
 	void  mem_free(void* ptr);
-	void* mem_alloc0(const size_t size);
+	void* mem_alloc0(const size_t size, mem_tag tag = MEM_OTHER);
 
 	template<typename T>
 	inline bool nonnull(T* obj)
@@ -148,12 +150,11 @@ namespace sys {
 		void clear()
 		{
 			zero();
-			m_length = 0;
 		}
 
 		bool empty() const
 		{
-			return (m_length == 0);
+			return (m_count == 0);
 		}
 
 		void zero()
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace sys {
+
+	// the subsystems memory is accounted to
+	enum mem_tag
+	{
+		MEM_OTHER = 0,
+		MEM_MAP,
+		MEM_GRID,
+		MEM_RENDER,
+		MEM_LIGHTING,
+		MEM_PARTICLES,
+		MEM_UI,
+		MEM_PARSER,
+
+		MEM_TAGS
+	};
+
+	struct mem_stats
+	{
+		size_t current;
+		size_t peak;
+		size_t allocs;
+		size_t frees;
+	};
+
+	// accounts size bytes allocated (or freed) by other means - new,
+	// containers, etc. - to tag.  mem_alloc/mem_free do this themselves
+	void mem_track(mem_tag tag, size_t size);
+	void mem_untrack(mem_tag tag, size_t size);
+
+	mem_stats mem_usage(mem_tag tag);
+	size_t mem_total();
+
+	const char* mem_tagname(mem_tag tag);
+
+	// writes the usage of every subsystem to the log
+	void mem_dump();
+
+}
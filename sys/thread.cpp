@@ -214,6 +214,20 @@ int thread::once(thread_tls *tls)
 #endif
 }
 
+int thread::nCpus()
+{
+#ifdef __PLATFORM_WIN32__
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return (int)info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n > 0 ? (int)n : 1);
+#endif
+}
+
 void thread::create_thread()
 {
 #ifdef __PLATFORM_WIN32__
@@ -39,4 +39,80 @@ void worker::work(workable* w)
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+worker_pool::member::member(worker_pool* p) : thread(THREAD_JOINABLE), m_pool(p), m_work(NULL)
+{
+}
+
+void worker_pool::member::thread_func()
+{
+	std::unique_lock<std::mutex> lock(m_pool->m_lock);
+
+	for (;;) {
+		m_pool->m_wake.wait(lock, [this] { return (m_work || m_pool->m_quit); });
+
+		if (!m_work) break;
+
+		workable* w = m_work;
+
+		lock.unlock();
+		w->work();
+		lock.lock();
+
+		m_work = NULL;
+
+		if (--m_pool->m_pending == 0) {
+			m_pool->m_done.notify_all();
+		}
+	}
+}
+
+worker_pool::worker_pool(int nthreads) : m_pending(0), m_quit(false)
+{
+	for (int i = 0; i < nthreads; i++) {
+		member* m = new member(this);
+
+		m_threads.push_back(m);
+		m->create_thread();
+	}
+}
+
+worker_pool::~worker_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++) {
+		m_threads[i]->join();
+		delete m_threads[i];
+	}
+}
+
+void worker_pool::start(size_t i, workable* w)
+{
+	if ((i >= m_threads.size()) || (!w)) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (m_threads[i]->m_work) return;
+
+		m_threads[i]->m_work = w;
+		m_pending++;
+	}
+
+	m_wake.notify_all();
+}
+
+void worker_pool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	m_done.wait(lock, [this] { return (m_pending == 0); });
+}
+
 }
@@ -3,6 +3,10 @@
 #include "thread.h"
 #include "token.h"
 
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
 namespace sys {
 
 	class workable
@@ -33,4 +37,43 @@ namespace sys {
 
 	};
 
+	// Threads which are started once and then handed work over and over,
+	// for work too short to be worth starting a thread for each time
+	class worker_pool
+	{
+	public:
+		explicit worker_pool(int nthreads);
+		~worker_pool();
+
+		size_t size() const { return m_threads.size(); }
+
+		// hands w to thread i and returns at once
+		void start(size_t i, workable* w);
+
+		// blocks until everything started has finished
+		void wait();
+
+	protected:
+
+		class member : public thread
+		{
+		public:
+			member(worker_pool* p);
+
+			void thread_func();
+
+			worker_pool* m_pool;
+			workable* m_work;
+		};
+
+		std::vector<member*> m_threads;
+
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+
+		int m_pending;
+		bool m_quit;
+	};
+
 }
@@ -0,0 +1,494 @@
+#include "terminal.h"
+
+#include "TileEngine.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <conio.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#endif
+
+namespace gtti {
+
+namespace {
+
+// CP437 to Unicode, 0 and 255 are shown as spaces
+const unsigned short sCP437[256] = {
+    0x0020, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022, 0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C,
+    0x25BA, 0x25C4, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8, 0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047, 0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057, 0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067, 0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077, 0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302,
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7, 0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9, 0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA, 0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4, 0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x0020,
+};
+
+// the UTF-8 of every glyph, built once
+struct utf8_table
+{
+    char glyphs[256][4];
+
+    utf8_table()
+    {
+        for (int i = 0; i < 256; i++) {
+            unsigned int u = sCP437[i];
+            char *s = glyphs[i];
+
+            if (u < 0x80) {
+                s[0] = (char)u;
+                s[1] = 0;
+            } else if (u < 0x800) {
+                s[0] = (char)(0xC0 | (u >> 6));
+                s[1] = (char)(0x80 | (u & 0x3F));
+                s[2] = 0;
+            } else {
+                s[0] = (char)(0xE0 | (u >> 12));
+                s[1] = (char)(0x80 | ((u >> 6) & 0x3F));
+                s[2] = (char)(0x80 | (u & 0x3F));
+                s[3] = 0;
+            }
+        }
+    }
+};
+
+const utf8_table sUTF8;
+
+inline size_t digits(int n)
+{
+    return ((n < 10) ? 1 : ((n < 100) ? 2 : 3));
+}
+
+// length of ";r;g;b" for a 0xRRGGBB color
+inline size_t rgbLength(unsigned int c)
+{
+    return 3 + digits((c >> 16) & 0xFF) + digits((c >> 8) & 0xFF) + digits(c & 0xFF);
+}
+
+inline void appendInt(std::string &s, int n)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", n);
+    s += buf;
+}
+
+void appendRGB(std::string &s, unsigned int c)
+{
+    s += ';';
+    appendInt(s, (c >> 16) & 0xFF);
+    s += ';';
+    appendInt(s, (c >> 8) & 0xFF);
+    s += ';';
+    appendInt(s, c & 0xFF);
+}
+
+// bytes for the color codes of c, updating fg and bg to what they become
+size_t colorCost(unsigned int glyph, unsigned int cfg, unsigned int cbg, int &fg, int &bg)
+{
+    bool sendFg = ((glyph != ' ') && (fg != (int)cfg));
+    bool sendBg = (bg != (int)cbg);
+
+    if (!sendFg && !sendBg) return 0;
+
+    // "\x1b[" ... "m", joined by ';'
+    size_t n = 3;
+
+    if (sendFg) { n += 4 + rgbLength(cfg); fg = (int)cfg; }
+    if (sendBg) { n += 4 + rgbLength(cbg); bg = (int)cbg; }
+    if (sendFg && sendBg) n += 1;
+
+    return n;
+}
+
+// the shortest way from (cx, cy) to (x, y), cx and cy are -1 if unknown
+std::string moveString(int cx, int cy, int x, int y)
+{
+    std::string best = "\x1b[";
+    appendInt(best, y + 1);
+    best += ';';
+    appendInt(best, x + 1);
+    best += 'H';
+
+    if ((cx < 0) || (cy < 0)) return best;
+
+    std::string s;
+
+    if ((cy == y) && (x > cx)) {
+        s = "\x1b[";
+        if (x - cx > 1) appendInt(s, x - cx);
+        s += 'C';
+    } else if ((cy == y) && (x < cx)) {
+        if (x == 0) {
+            s = "\r";
+        } else {
+            s = "\x1b[";
+            if (cx - x > 1) appendInt(s, cx - x);
+            s += 'D';
+        }
+    } else if ((x == 0) && (y == cy + 1)) {
+        s = "\r\n";
+    }
+
+    return ((!s.empty() && (s.size() < best.size())) ? s : best);
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+terminal_backend::terminal_backend()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+terminal_backend::~terminal_backend()
+{
+    close();
+}
+
+const char* terminal_backend::glyph(unsigned char c)
+{
+    return sUTF8.glyphs[c];
+}
+
+bool terminal_backend::open(int, int, const char *)
+{
+    if (_open) return true;
+
+    fflush(stdout);
+
+#ifdef _WIN32
+    _fd = _dup(1);
+#else
+    _fd = dup(STDOUT_FILENO);
+
+    // anything else printed would tear the frame, stdout goes nowhere
+    // while the terminal is ours
+    int nul = ::open("/dev/null", O_WRONLY);
+    if (nul >= 0) {
+        _stdout = dup(STDOUT_FILENO);
+        dup2(nul, STDOUT_FILENO);
+        ::close(nul);
+    }
+
+    struct termios *saved = new struct termios;
+
+    if (tcgetattr(STDIN_FILENO, saved) == 0) {
+        struct termios raw = *saved;
+
+        cfmakeraw(&raw);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        _saved = saved;
+    } else {
+        delete saved;
+    }
+#endif
+
+    // alternate screen, no cursor, default colors, cleared
+    _out = "\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J";
+    flush();
+
+    _cx = _cy = -1;
+    _fg = _bg = -1;
+    _open = true;
+
+    return true;
+}
+
+void terminal_backend::close()
+{
+    if (!_open) return;
+
+    _out = "\x1b[0m\x1b[?25h\x1b[?1049l";
+    flush();
+
+#ifdef _WIN32
+    _close(_fd);
+#else
+    if (_saved) {
+        struct termios *saved = (struct termios*)_saved;
+
+        tcsetattr(STDIN_FILENO, TCSANOW, saved);
+        delete saved;
+        _saved = nullptr;
+    }
+
+    fflush(stdout);
+
+    if (_stdout >= 0) {
+        dup2(_stdout, STDOUT_FILENO);
+        ::close(_stdout);
+        _stdout = -1;
+    }
+
+    ::close(_fd);
+#endif
+
+    _fd = -1;
+    _open = false;
+}
+
+terminal_backend::cell terminal_backend::toCell(const FilterBuffer &frame, int i)
+{
+    cell c;
+    unsigned char g = frame.glyph[i];
+
+    c.glyph = (((g == 0) || (g == 255)) ? ' ' : g);
+
+    // terminal cells are opaque, whatever is transparent is over black
+    int fa = frame.fg[FilterBuffer::A][i];
+    int ba = frame.bg[FilterBuffer::A][i];
+
+    c.fg = (((frame.fg[FilterBuffer::R][i] * fa / 255) << 16) |
+            ((frame.fg[FilterBuffer::G][i] * fa / 255) << 8) |
+             (frame.fg[FilterBuffer::B][i] * fa / 255));
+    c.bg = (((frame.bg[FilterBuffer::R][i] * ba / 255) << 16) |
+            ((frame.bg[FilterBuffer::G][i] * ba / 255) << 8) |
+             (frame.bg[FilterBuffer::B][i] * ba / 255));
+
+    return c;
+}
+
+size_t terminal_backend::cost(const cell &c) const
+{
+    int fg = _fg, bg = _bg;
+
+    return colorCost(c.glyph, c.fg, c.bg, fg, bg) + strlen(glyph((unsigned char)c.glyph));
+}
+
+void terminal_backend::color(const cell &c)
+{
+    bool sendFg = ((c.glyph != ' ') && (_fg != (int)c.fg));
+    bool sendBg = (_bg != (int)c.bg);
+
+    if (!sendFg && !sendBg) return;
+
+    _out += "\x1b[";
+
+    if (sendFg) {
+        _out += "38;2";
+        appendRGB(_out, c.fg);
+        _fg = (int)c.fg;
+    }
+
+    if (sendBg) {
+        if (sendFg) _out += ';';
+        _out += "48;2";
+        appendRGB(_out, c.bg);
+        _bg = (int)c.bg;
+    }
+
+    _out += 'm';
+}
+
+void terminal_backend::put(const cell &c)
+{
+    color(c);
+    _out += glyph((unsigned char)c.glyph);
+
+    // past the last column the terminal is waiting to wrap, and terminals
+    // do not agree on where the cursor is then
+    if (++_cx >= _width) {
+        _cx = _cy = -1;
+    }
+}
+
+void terminal_backend::moveTo(int x, int y)
+{
+    if ((_cx == x) && (_cy == y)) return;
+
+    _out += moveString(_cx, _cy, x, y);
+    _cx = x;
+    _cy = y;
+}
+
+void terminal_backend::present(const FilterBuffer &frame)
+{
+    if (!_open) return;
+
+    if ((frame.width != _width) || (frame.height != _height)) {
+        _width = frame.width;
+        _height = frame.height;
+
+        // nothing is known to be on screen
+        cell unknown = { 0, 0, 0 };
+        _shown.assign(_width * _height, unknown);
+        _out += "\x1b[2J";
+    }
+
+    int changed = 0;
+
+    for (int y = 0; y < _height; y++) {
+        for (int x = 0; x < _width; x++) {
+            int i = x + y * _width;
+            cell c = toCell(frame, i);
+
+            if (c == _shown[i]) continue;
+
+            // a short gap on the same row is cheaper to write again than
+            // to jump over
+            if ((_cy == y) && (_cx >= 0) && (_cx < x)) {
+                size_t rewrite = 0;
+                int fg = _fg, bg = _bg;
+
+                for (int gx = _cx; gx < x; gx++) {
+                    const cell &g = _shown[gx + y * _width];
+                    rewrite += colorCost(g.glyph, g.fg, g.bg, fg, bg) + strlen(glyph((unsigned char)g.glyph));
+                }
+
+                if (rewrite <= moveString(_cx, _cy, x, y).size()) {
+                    for (int gx = _cx; gx < x; gx++) {
+                        put(_shown[gx + y * _width]);
+                    }
+                }
+            }
+
+            moveTo(x, y);
+            put(c);
+
+            _shown[i] = c;
+            changed++;
+        }
+    }
+
+    _stats.frames++;
+    _stats.lastCells = changed;
+    _stats.lastBytes = _out.size();
+    _stats.bytes += _out.size();
+
+    flush();
+}
+
+void terminal_backend::flush()
+{
+    const char *p = _out.data();
+    size_t n = _out.size();
+
+    while ((n > 0) && (_fd >= 0)) {
+#ifdef _WIN32
+        int w = _write(_fd, p, (unsigned int)n);
+#else
+        ssize_t w = write(_fd, p, n);
+#endif
+        if (w <= 0) break;
+
+        p += w;
+        n -= w;
+    }
+
+    _out.clear();
+}
+
+int terminal_backend::keyPressed()
+{
+#ifdef _WIN32
+    if (!_kbhit()) return 0;
+
+    int c = _getch();
+
+    // arrows come as 0 or 0xE0 and a scan code
+    if ((c == 0) || (c == 0xE0)) {
+        switch (_getch()) {
+            case 72: return KEY_UP;
+            case 80: return KEY_DOWN;
+            case 75: return KEY_LEFT;
+            case 77: return KEY_RIGHT;
+            case 61: return KEY_F3;
+            case 62: return KEY_F4;
+            case 63: return KEY_F5;
+            case 67: return KEY_F9;
+            default: return 0;
+        }
+    }
+
+    if (c == 3) { _closing = true; return 0; }
+    if (c == 27) return KEY_ESCAPE;
+    if (c == '\r') return KEY_ENTER;
+    if (c == '\t') return KEY_TAB;
+    if (c == 8) return KEY_BACKSPACE;
+
+    return c;
+#else
+    char buf[64];
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+
+    if (n > 0) {
+        _pending.append(buf, n);
+    }
+
+    if (_pending.empty()) return 0;
+
+    unsigned char c = (unsigned char)_pending[0];
+    size_t used = 1;
+    int key = c;
+
+    if (c == 0x1b) {
+        key = KEY_ESCAPE;
+
+        // CSI (ESC [) and SS3 (ESC O) sequences end with a byte in 0x40-0x7e
+        if ((_pending.size() > 1) && ((_pending[1] == '[') || (_pending[1] == 'O'))) {
+            size_t end = 2;
+            while ((end < _pending.size()) && !((_pending[end] >= 0x40) && (_pending[end] <= 0x7e))) end++;
+
+            if (end < _pending.size()) {
+                std::string seq = _pending.substr(2, end - 2);
+                used = end + 1;
+                key = 0;
+
+                switch (_pending[end]) {
+                    case 'A': key = KEY_UP; break;
+                    case 'B': key = KEY_DOWN; break;
+                    case 'C': key = KEY_RIGHT; break;
+                    case 'D': key = KEY_LEFT; break;
+                    case 'P': key = KEY_F1; break;
+                    case 'Q': key = KEY_F2; break;
+                    case 'R': key = KEY_F3; break;
+                    case 'S': key = KEY_F4; break;
+                    case '~':
+                        if (seq == "15") key = KEY_F5;
+                        else if (seq == "17") key = KEY_F6;
+                        else if (seq == "18") key = KEY_F7;
+                        else if (seq == "19") key = KEY_F8;
+                        else if (seq == "20") key = KEY_F9;
+                        else if (seq == "21") key = KEY_F10;
+                        break;
+                    default: break;
+                }
+            }
+        }
+    } else if (c == 3) {
+        // ^C, raw mode keeps it from being a signal
+        _closing = true;
+        key = 0;
+    } else if ((c == '\r') || (c == '\n')) {
+        key = KEY_ENTER;
+    } else if (c == '\t') {
+        key = KEY_TAB;
+    } else if (c == 0x7f) {
+        key = KEY_BACKSPACE;
+    }
+
+    _pending.erase(0, used);
+
+    return key;
+#endif
+}
+
+} // namespace gtti
@@ -0,0 +1,111 @@
+#ifndef __INCLUDE_TERMINAL_H__
+#define __INCLUDE_TERMINAL_H__
+
+#include "backend.h"
+
+#include <string>
+#include <vector>
+
+namespace gtti {
+
+// Draws the frame of cells to an ANSI terminal with 24 bit color, for play
+// over ssh.  The last frame sent is kept and only cells which differ are
+// written; runs of changed cells are written in one go, small gaps between
+// them are rewritten when that is shorter than moving the cursor, and color
+// codes are only sent when the color actually changes.  Glyphs are mapped
+// from CP437 to UTF-8.  Keys are read from the terminal in raw mode
+class terminal_backend : public backend
+{
+public:
+    struct stats
+    {
+        unsigned long long frames;
+        unsigned long long bytes;   // in total
+        size_t lastBytes;           // of the last frame
+        int lastCells;              // cells changed in the last frame
+    };
+
+    terminal_backend();
+    ~terminal_backend();
+
+    bool open(int w, int h, const char *title);
+    void close();
+    bool closing() const { return _closing; }
+
+    // there are no pixels, textures are only handed out
+    handle loadTexture(Image) { return _next++; }
+    handle createTarget(int, int) { return _next++; }
+    void unload(handle) {}
+
+    void beginFrame() {}
+    void endFrame() {}
+    void beginTarget(handle) {}
+    void endTarget() {}
+    void clear(::Color) {}
+    void fill(const Rectangle &, ::Color) {}
+    void blit(handle, const Rectangle &, const Vector2 &, ::Color) {}
+    void blitTarget(handle, const Vector2 &) {}
+
+    bool cells() const { return true; }
+    void present(const FilterBuffer &frame);
+
+    int keyPressed();
+
+    const stats& statistics() const { return _stats; }
+
+    // the UTF-8 encoding of a CP437 glyph
+    static const char* glyph(unsigned char c);
+
+protected:
+
+    // a cell as the terminal shows it
+    struct cell
+    {
+        unsigned int glyph;     // 0 means unknown (forces a write)
+        unsigned int fg;        // 0xRRGGBB
+        unsigned int bg;
+
+        bool operator==(const cell &rhs) const
+        {
+            // the foreground of a blank cell is never seen
+            return ((glyph == rhs.glyph) && (bg == rhs.bg) && ((glyph == ' ') || (fg == rhs.fg)));
+        }
+        bool operator!=(const cell &rhs) const { return !(*this == rhs); }
+    };
+
+    static cell toCell(const FilterBuffer &frame, int i);
+
+    // bytes needed to write c with the current colors (without sending)
+    size_t cost(const cell &c) const;
+
+    void moveTo(int x, int y);
+    void put(const cell &c);
+    void color(const cell &c);
+    void flush();
+
+    std::vector<cell> _shown;
+    int _width = 0;
+    int _height = 0;
+
+    // what the terminal is at, -1 if unknown
+    int _cx = -1;
+    int _cy = -1;
+    int _fg = -1;
+    int _bg = -1;
+
+    std::string _out;
+    stats _stats;
+
+    handle _next = 1;
+    bool _open = false;
+    bool _closing = false;
+
+    int _fd = -1;           // the terminal
+    int _stdout = -1;       // stdout, sent elsewhere while the terminal is drawn
+    std::string _pending;   // key bytes read but not used yet
+    void *_saved = nullptr; // terminal settings to restore
+};
+
+} // namespace gtti
+
+#endif
@@ -0,0 +1,257 @@
+#include "timewheel.h"
+
+#include <algorithm>
+
+const unsigned long long AnimationScheduler::sNEVER = ~0ULL;
+AnimationScheduler* AnimationScheduler::s_current = NULL;
+
+AnimationScheduler* AnimationScheduler::current()
+{
+	return s_current;
+}
+
+void AnimationScheduler::setCurrent(AnimationScheduler* s)
+{
+	s_current = s;
+}
+
+AnimationScheduler::AnimationScheduler(int ticksPerSecond) :
+	m_now(0),
+	m_ticksPerSecond(std::max(1, ticksPerSecond)),
+	m_start(clock::now()),
+	m_free(-1),
+	m_nextId(1),
+	m_count(0)
+{
+}
+
+AnimationScheduler::~AnimationScheduler()
+{
+}
+
+unsigned int AnimationScheduler::add(Timed* t, int ticks)
+{
+	int e = m_free;
+
+	if (e >= 0) {
+		m_free = m_entries[e].next;
+	} else {
+		e = (int)m_entries.size();
+		m_entries.push_back(Entry());
+	}
+
+	Entry& entry = m_entries[e];
+	entry.item = t;
+	entry.due = m_now + std::max(1, ticks);
+	entry.id = m_nextId++;
+	entry.next = -1;
+
+	m_ids[entry.id] = e;
+	m_count++;
+
+	place(e);
+
+	return entry.id;
+}
+
+void AnimationScheduler::cancel(unsigned int id)
+{
+	std::unordered_map<unsigned int, int>::iterator it = m_ids.find(id);
+	if (it == m_ids.end()) return;
+
+	// the entry is dropped when the wheels next come to its slot
+	m_entries[it->second].item = NULL;
+	m_ids.erase(it);
+	m_count--;
+}
+
+void AnimationScheduler::release(int e)
+{
+	m_entries[e].item = NULL;
+	m_entries[e].next = m_free;
+	m_free = e;
+}
+
+void AnimationScheduler::place(int e)
+{
+	const unsigned long long due = m_entries[e].due;
+	const unsigned long long delta = due - m_now;
+
+	int level = 0;
+
+	while ((level < sLEVELS - 1) && (delta >= (1ULL << (sBITS * (level + 1))))) {
+		level++;
+	}
+
+	m_wheels[level][(due >> (sBITS * level)) & (sSLOTS - 1)].push_back(e);
+}
+
+void AnimationScheduler::cascade(int level)
+{
+	std::vector<int> slot;
+	slot.swap(m_wheels[level][(m_now >> (sBITS * level)) & (sSLOTS - 1)]);
+
+	for (int e : slot) {
+		if (m_entries[e].item) {
+			place(e);
+		} else {
+			release(e);
+		}
+	}
+}
+
+int AnimationScheduler::advance()
+{
+	clock::duration elapsed = clock::now() - m_start;
+
+	unsigned long long tick = (unsigned long long)
+		(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() * m_ticksPerSecond / 1000000);
+
+	return advanceTo(tick);
+}
+
+int AnimationScheduler::advanceTo(unsigned long long tick)
+{
+	int ran = 0;
+	std::vector<int> slot;
+
+	while (m_now < tick) {
+		// nothing waiting, the wheels can jump
+		if (m_count == 0) {
+			for (int l = 0; l < sLEVELS; l++) {
+				for (int s = 0; s < sSLOTS; s++) {
+					m_wheels[l][s].clear();
+				}
+			}
+
+			m_entries.clear();
+			m_free = -1;
+			m_now = tick;
+			break;
+		}
+
+		m_now++;
+
+		// a wheel which turned all the way round moves the next slot of the
+		// wheel above in
+		for (int l = 1; l < sLEVELS; l++) {
+			if ((m_now & ((1ULL << (sBITS * l)) - 1)) != 0) break;
+			cascade(l);
+		}
+
+		slot.clear();
+		slot.swap(m_wheels[0][m_now & (sSLOTS - 1)]);
+
+		for (int e : slot) {
+			Timed* t = m_entries[e].item;
+
+			if (!t) {
+				release(e);
+				continue;
+			}
+
+			unsigned int id = m_entries[e].id;
+
+			// fire() may add or cancel entries (m_entries can move)
+			int next = t->fire();
+			ran++;
+
+			if (!m_entries[e].item) {
+				// cancelled while it ran
+				release(e);
+			} else if (next <= 0) {
+				m_ids.erase(id);
+				m_count--;
+				release(e);
+			} else {
+				m_entries[e].due = m_now + next;
+				place(e);
+			}
+		}
+	}
+
+	return ran;
+}
+
+unsigned long long AnimationScheduler::nextDue() const
+{
+	if (m_count == 0) return sNEVER;
+
+	unsigned long long best = sNEVER;
+
+	// the first slot holding anything on each wheel.  Outer wheels can hold
+	// items due before some on the inner ones, so every wheel is looked at
+	for (int l = 0; l < sLEVELS; l++) {
+		unsigned long long cur = (m_now >> (sBITS * l));
+
+		for (int i = 1; i <= sSLOTS; i++) {
+			const std::vector<int>& slot = m_wheels[l][(cur + i) & (sSLOTS - 1)];
+			bool found = false;
+
+			for (int e : slot) {
+				if (m_entries[e].item) {
+					best = std::min(best, m_entries[e].due);
+					found = true;
+				}
+			}
+
+			if (found) break;
+		}
+	}
+
+	return best;
+}
+
+AnimationScheduler::clock::time_point AnimationScheduler::nextWake() const
+{
+	unsigned long long due = nextDue();
+
+	if (due == sNEVER) return clock::time_point::max();
+
+	return m_start + std::chrono::duration_cast<clock::duration>(
+		std::chrono::duration<double>((double)due / (double)m_ticksPerSecond));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Timer::Timer() : m_scheduler(NULL), m_id(0)
+{
+}
+
+Timer::~Timer()
+{
+	stop();
+}
+
+bool Timer::start(int ticks, const callback& cb)
+{
+	stop();
+
+	AnimationScheduler* s = AnimationScheduler::current();
+	if (!s) return false;
+
+	m_callback = cb;
+	m_scheduler = s;
+	m_id = s->add(this, ticks);
+
+	return true;
+}
+
+void Timer::stop()
+{
+	if (m_scheduler) {
+		m_scheduler->cancel(m_id);
+		m_scheduler = NULL;
+	}
+}
+
+int Timer::fire()
+{
+	int next = (m_callback ? m_callback() : 0);
+
+	if (next <= 0) {
+		m_scheduler = NULL;
+	}
+
+	return next;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "common.h"
+
+#include <chrono>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+// Anything the AnimationScheduler runs
+class Timed
+{
+public:
+	Timed() {}
+	virtual ~Timed() {}
+
+	// runs when due, returning the ticks until it is due again (0 when it
+	// is done and should be dropped)
+	virtual int fire() = 0;
+};
+
+// Runs animations when they are due instead of ticking every one of them
+// every frame.  Each registered item has a deadline (in ticks, FPS to a
+// second) kept in a hierarchical timing wheel: 4 wheels of 64 slots, each
+// slot of a wheel spanning a whole turn of the wheel below.  Adding,
+// cancelling and advancing a tick are O(1); items in the outer wheels move
+// inwards as their time comes closer.
+//
+// The scheduler knows when the next item is due, so the frame loop can
+// sleep exactly until then and frames in between do no animation work.
+//
+//		unsigned int id = scheduler.add(&animation, 5);
+//		...
+//		if (scheduler.advance() > 0) redraw.invalidate();
+//		redraw.wakeAt(scheduler.nextWake());
+//
+class AnimationScheduler
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	AnimationScheduler(int ticksPerSecond = FPS);
+	~AnimationScheduler();
+
+	// t is first run in ticks (at least 1), and again for as long as it
+	// asks to be.  t must outlive its entry (or be cancelled)
+	unsigned int add(Timed* t, int ticks);
+	void cancel(unsigned int id);
+
+	// runs everything due up to now (or tick), returning how many ran
+	int advance();
+	int advanceTo(unsigned long long tick);
+
+	// the tick of the next item due, or sNEVER
+	unsigned long long nextDue() const;
+	// when the next item is due, time_point::max() if nothing is waiting
+	clock::time_point nextWake() const;
+
+	unsigned long long now() const { return m_now; }
+	size_t size() const { return m_count; }
+
+	// the scheduler timers register with (the engine's), or NULL
+	static AnimationScheduler* current();
+	static void setCurrent(AnimationScheduler* s);
+
+	static const unsigned long long sNEVER;
+
+protected:
+
+	static const int sLEVELS = 4;
+	static const int sBITS = 6;
+	static const int sSLOTS = 1 << sBITS;
+
+	struct Entry
+	{
+		Timed* item;				// NULL once cancelled
+		unsigned long long due;
+		unsigned int id;
+		int next;					// the free list
+	};
+
+	// puts entry e in the slot its deadline falls in
+	void place(int e);
+	// moves the entries of a slot of an outer wheel inwards
+	void cascade(int level);
+	void release(int e);
+
+	// the tick the wheels are at
+	unsigned long long m_now;
+	int m_ticksPerSecond;
+	clock::time_point m_start;
+
+	std::vector<int> m_wheels[sLEVELS][sSLOTS];
+	std::vector<Entry> m_entries;
+	int m_free;
+	std::unordered_map<unsigned int, int> m_ids;	// id to entry
+
+	unsigned int m_nextId;
+	size_t m_count;
+
+	static AnimationScheduler* s_current;
+};
+
+// A deadline kept for something which is not a Timed itself, e.g. a delay a
+// filter waits on.  The callback runs when it is due and returns the ticks
+// until it is due again (0 to stop).  Stops itself when destroyed
+class Timer : public Timed
+{
+public:
+	typedef std::function<int()> callback;
+
+	Timer();
+	~Timer();
+
+	// due in ticks on the current scheduler, false if there is none (the
+	// owner then has to keep time itself)
+	bool start(int ticks, const callback& cb);
+	void stop();
+
+	bool running() const { return (m_scheduler != NULL); }
+
+	int fire();
+
+protected:
+
+	AnimationScheduler* m_scheduler;
+	unsigned int m_id;
+	callback m_callback;
+};
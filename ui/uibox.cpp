@@ -12,8 +12,8 @@ block::block(int icon, const gtti::Color &color, const Rect &rect, widget *paren
 
     for (int x = 0; x < _console->width(); x++) {
         for (int y = 0; y < _console->height(); y++) {
-            _console->at(x, y).setChar(icon);
-            _console->at(x, y).setForegroundColor(color.toColor());
+            _console->setChar(x, y, icon);
+            _console->setCharForeground(x, y, color.toColor());
         }
     }
 }
@@ -119,11 +119,15 @@ widget::widget(widget *parent) :
 	m_child(NULL),
 	m_parent(parent)
 {
+	// only the base is known here, so this is a lower bound per widget
+	sys::mem_track(sys::MEM_UI, sizeof(widget));
 }
 
 
 widget::~widget(void)
 {
+	sys::mem_untrack(sys::MEM_UI, sizeof(widget));
+
 	delete m_child;
 }
 
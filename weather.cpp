@@ -0,0 +1,179 @@
+#include "weather.h"
+#include "common.h"
+#include "rnd.h"
+
+#include <algorithm>
+#include <math.h>
+
+WeatherFilter::WeatherFilter(const Weather &w, int capacity) :
+    _particles(capacity), _weather(w),
+    _flash(0.1f, 0.0f, 0.5f, gtti::Color::white)
+{
+    _particles.setWind(w.wind);
+}
+
+WeatherFilter::~WeatherFilter()
+{
+
+}
+
+void WeatherFilter::setWeather(const Weather &w)
+{
+    _weather = w;
+    _particles.setWind(w.wind);
+}
+
+void WeatherFilter::flash()
+{
+    _flash.reset();
+    _flashing = true;
+}
+
+void WeatherFilter::spawn(ParticleType type, float rate, float &owed, bool fill)
+{
+    if ((rate <= 0.0f) || (_width <= 0)) return;
+
+    const PointF v = _particles.drift(type);
+    const float perTick = rate * (float)_width / (float)FPS;
+
+    // ash hangs in the air and starts anywhere
+    if ((type == P_ASH) || (v.y() <= 0.0f)) {
+        owed += perTick * (fill ? (float)(20 * 20) : 1.0f);
+
+        for (; owed >= 1.0f; owed -= 1.0f) {
+            PointF p((float)Rnd::rndn() * _width, (float)Rnd::rndn() * _height);
+            if (!_particles.spawn(type, p)) { owed = 0.0f; break; }
+        }
+        return;
+    }
+
+    // the rest fall in from the top, starting upwind so they cover the
+    // whole frame on the way down
+    const float ticks = (float)_height / v.y();
+    const float dx = std::max((float)-_width, std::min((float)_width, -v.x() * ticks));
+    const float left = std::min(0.0f, dx);
+    const float span = (float)_width + fabsf(dx);
+
+    owed += perTick * (span / (float)_width) * (fill ? ticks : 1.0f);
+
+    for (; owed >= 1.0f; owed -= 1.0f) {
+        float x = left + (float)Rnd::rndn() * span;
+        float y = -1.0f;
+
+        // as if it had been falling all along
+        if (fill) {
+            y = (float)Rnd::rndn() * _height;
+            x += v.x() * (y / v.y());
+        }
+
+        if (!_particles.spawn(type, PointF(x, y))) { owed = 0.0f; break; }
+    }
+}
+
+void WeatherFilter::begin()
+{
+    if (_width > 0) {
+        spawn(P_RAIN, _weather.rain, _rainOwed, false);
+        spawn(P_SNOW, _weather.snow, _snowOwed, false);
+        spawn(P_ASH, _weather.ash, _ashOwed, false);
+
+        _particles.update();
+    }
+
+    if (_flashing) {
+        if (_flash.done()) {
+            _flashing = false;
+        } else {
+            _flash.begin();
+        }
+    }
+}
+
+bool WeatherFilter::changing() const
+{
+    if (_flashing || (_particles.count() > 0)) return true;
+
+    return (_weather.rain > 0.0f) || (_weather.snow > 0.0f) || (_weather.ash > 0.0f);
+}
+
+void WeatherFilter::apply(FilterBuffer &buf)
+{
+    if ((buf.width != _width) || (buf.height != _height)) {
+        bool first = (_width == 0);
+
+        _width = buf.width;
+        _height = buf.height;
+        _particles.setBounds(_width, _height);
+
+        // start with the sky already full
+        if (first) {
+            spawn(P_RAIN, _weather.rain, _rainOwed, true);
+            spawn(P_SNOW, _weather.snow, _snowOwed, true);
+            spawn(P_ASH, _weather.ash, _ashOwed, true);
+        }
+    }
+
+    if (_weather.overcast > 0.0f) {
+        tint(buf, gtti::Color(77, 80, 87), _weather.overcast);
+    }
+
+    _particles.render(buf);
+
+    if (_flashing) {
+        _flash.apply(buf);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    Weather storm()
+    {
+        Weather w;
+
+        w.rain = 1.0f;
+        w.wind = PointF(0.35f, 0.0f);
+        w.overcast = 0.2f;
+
+        return w;
+    }
+
+}
+
+ThunderstormFilter::ThunderstormFilter() :
+    WeatherFilter(storm()),
+    _strike(FPS * Rnd::betweenf(3.5f, 6.0f))
+{
+
+}
+
+ThunderstormFilter::~ThunderstormFilter()
+{
+
+}
+
+void ThunderstormFilter::begin()
+{
+    WeatherFilter::begin();
+
+    // strikes are kept on the animation scheduler if there is one
+    if (!_striking.running() &&
+        !_striking.start(_strike.ticksLeft(), [this] { return strike(); })) {
+
+        if (_strike.tick()) {
+            strike();
+        }
+    }
+}
+
+int ThunderstormFilter::strike()
+{
+    if (Rnd::one_in(3)) {
+        flash();
+    }
+
+    _strike.restart(FPS * Rnd::betweenf(2.0f, 5.0f));
+
+    return _strike.timeout();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TileEngine.h"
+#include "particles.h"
+
+// What the sky is doing.  Rates are particles per column per second
+struct Weather
+{
+    float rain = 0.0f;
+    float snow = 0.0f;
+    float ash = 0.0f;
+
+    PointF wind;                // cells per tick
+    float overcast = 0.0f;      // how far the frame is tinted grey
+};
+
+// Rain, snow and ash as a field of particles over the frame, carried by the
+// wind.  The work done per frame depends on how many particles are about,
+// not on how many cells the frame has.  Lightning is one flash of the whole
+// frame, started with flash()
+class WeatherFilter : public Filter
+{
+public:
+    WeatherFilter(const Weather &w = Weather(), int capacity = 16384);
+    virtual ~WeatherFilter();
+
+    void setWeather(const Weather &w);
+    const Weather& weather() const { return _weather; }
+
+    void flash();
+
+    void begin();
+    void apply(FilterBuffer &buf);
+
+    // a clear sky only changes when it flashes
+    bool changing() const;
+
+    int particles() const { return _particles.count(); }
+
+protected:
+
+    // spawns this tick's share of rate particles of type along the top (or
+    // anywhere, with fill)
+    void spawn(ParticleType type, float rate, float &owed, bool fill);
+
+    ParticleSystem _particles;
+    Weather _weather;
+
+    FadeFilter _flash;
+    bool _flashing = false;
+
+    // fractions of a particle left over from the last tick
+    float _rainOwed = 0.0f;
+    float _snowOwed = 0.0f;
+    float _ashOwed = 0.0f;
+
+    // of the last frame, the field is filled when first known
+    int _width = 0;
+    int _height = 0;
+};
+
+// Heavy rain blown across the screen, with the odd lightning strike
+class ThunderstormFilter : public WeatherFilter
+{
+    ConstantDelay _strike;
+    Timer _striking;
+
+    // maybe flashes, returning the ticks until the next strike
+    int strike();
+
+public:
+    ThunderstormFilter();
+    virtual ~ThunderstormFilter();
+
+    void begin();
+};